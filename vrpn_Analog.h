@@ -25,6 +25,12 @@ const int vrpn_ANALOG_FAIL = (-2);
 // Analog time value meaning "go find out what time it is right now"
 const struct timeval vrpn_ANALOG_NOW = {0, 0};
 
+// Compact reports carry every channel at least this often (in reports or
+// seconds, whichever comes first), so that a remote that lost one sent over
+// an unreliable class of service does not hold a stale value for long.
+const int vrpn_ANALOG_COMPACT_KEYFRAME_REPORTS = 64;
+const int vrpn_ANALOG_COMPACT_KEYFRAME_SECONDS = 1;
+
 class VRPN_API vrpn_Analog : public vrpn_BaseClass {
 public:
     vrpn_Analog(const char *name, vrpn_Connection *c = NULL);
@@ -34,6 +40,11 @@ public:
 
     vrpn_int32 getNumChannels(void) const;
 
+    /// How a channel's value is carried in compact reports.  SCALED_INT16
+    /// sends round((value - offset) / scale), clamped to the range of a
+    /// vrpn_int16, and the remote gets offset + scale times that back.
+    enum ChannelEncoding { FLOAT64 = 0, FLOAT32 = 1, SCALED_INT16 = 2 };
+
 protected:
     vrpn_float64 channel[vrpn_CHANNEL_MAX];
     vrpn_float64 last[vrpn_CHANNEL_MAX];
@@ -42,6 +53,24 @@ protected:
     vrpn_int32 channel_m_id; //< channel message id (message from server)
     int status;
 
+    /// @name Compact reports
+    /// Instead of all of the channels as float64s, a compact report has
+    /// only those whose value (once encoded) has changed since the last
+    /// report, each in the encoding chosen for it.  A server only sends
+    /// them once it has been told to and every remote connected to it has
+    /// said that it can decode them; it goes back to full reports whenever
+    /// a connection comes or goes until they have all said so again.
+    /// @{
+    vrpn_int32 compact_m_id;         //< changed channels (from server)
+    vrpn_int32 compact_format_m_id;  //< channel encodings (from server)
+    vrpn_int32 compact_offer_m_id;   //< can you decode them? (from server)
+    vrpn_int32 compact_request_m_id; //< yes, send them (from remote)
+    vrpn_uint8 encoding[vrpn_CHANNEL_MAX];
+    vrpn_float64 encoding_scale[vrpn_CHANNEL_MAX];
+    vrpn_float64 encoding_offset[vrpn_CHANNEL_MAX];
+    vrpn_int32 encoding_generation; //< Changes whenever an encoding does
+    /// @}
+
     virtual int register_types(void);
 
     //------------------------------------------------------------------
@@ -57,6 +86,36 @@ protected:
     virtual void
     report(vrpn_uint32 class_of_service = vrpn_CONNECTION_LOW_LATENCY,
            const struct timeval time = vrpn_ANALOG_NOW);
+
+    /// Offer compact reports to remotes, or stop sending them (for
+    /// servers).  Call this before any clients connect, for example in the
+    /// constructor.  Returns 0 on success, -1 on failure.
+    int set_compact_reports(bool enable);
+    /// Choose how a channel is encoded in compact reports (for servers).
+    /// The scale must be positive for SCALED_INT16 and is ignored
+    /// otherwise, as is the offset.  Returns 0 on success, -1 on failure.
+    int set_channel_encoding(vrpn_int32 chan, ChannelEncoding enc,
+                             vrpn_float64 scale = 1.0,
+                             vrpn_float64 offset = 0.0);
+
+    /// Server-side state for compact reports.
+    bool compact_enabled; //< The server has offered them
+    bool compact_active;  //< Every connected remote has asked for them
+    vrpn_int32 compact_connections; //< How many remotes are connected
+    vrpn_int32 compact_requests;    //< How many connections asked this round
+    vrpn_int32 compact_round;       //< Which offer they are answering
+    vrpn_float64 compact_sent[vrpn_CHANNEL_MAX]; //< What the remotes have
+    int compact_since_keyframe;
+    struct timeval compact_keyframe_time;
+    bool compact_handlers_registered;
+
+    vrpn_int32 encode_compact_to(char *buf, bool keyframe);
+    void start_compact_negotiation(void);
+    void send_compact_format(void);
+    static int VRPN_CALLBACK
+    handle_compact_connection_change(void *userdata, vrpn_HANDLERPARAM p);
+    static int VRPN_CALLBACK
+    handle_compact_request_message(void *userdata, vrpn_HANDLERPARAM p);
 };
 
 #ifndef VRPN_CLIENT_ONLY
@@ -120,6 +179,20 @@ public:
     /// (May be clamped to vrpn_CHANNEL_MAX)
     /// This should be used before mainloop is ever called.
     vrpn_int32 setNumChannels(vrpn_int32 sizeRequested);
+
+    /// Makes public the protected base class function
+    int set_compact_reports(bool enable)
+    {
+        return vrpn_Analog::set_compact_reports(enable);
+    }
+
+    /// Makes public the protected base class function
+    int set_channel_encoding(vrpn_int32 chan, ChannelEncoding enc,
+                             vrpn_float64 scale = 1.0,
+                             vrpn_float64 offset = 0.0)
+    {
+        return vrpn_Analog::set_channel_encoding(chan, enc, scale, offset);
+    }
 };
 
 /// Analog server that can scale and clip its range to -1..1.
@@ -205,6 +278,12 @@ protected:
 
     static int VRPN_CALLBACK
     handle_change_message(void *userdata, vrpn_HANDLERPARAM p);
+    static int VRPN_CALLBACK
+    handle_compact_message(void *userdata, vrpn_HANDLERPARAM p);
+    static int VRPN_CALLBACK
+    handle_compact_format_message(void *userdata, vrpn_HANDLERPARAM p);
+    static int VRPN_CALLBACK
+    handle_compact_offer_message(void *userdata, vrpn_HANDLERPARAM p);
 };
 
 #endif
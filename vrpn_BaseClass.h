@@ -178,6 +178,8 @@ protected:
 extern VRPN_API vrpn_TextPrinter &vrpn_System_TextPrinter;
 #endif
 
+class vrpn_BaseClassHeartbeat;
+
 /// INTERNAL class to hold members that there should only be one copy of
 /// even when a class inherits from multiple vrpn_BaseClasses because it
 /// inherits from multiple user-level classes.  Note that not everything in
@@ -193,6 +195,17 @@ public:
     /// Returns a pointer to the connection this object is using
     vrpn_Connection *connectionPtr() { return d_connection; };
 
+    /// @brief Reports how busy this device is, from the counters our
+    /// connection keeps for its sender (see vrpn_Connection::get_sender_stats).
+    ///
+    /// Counts the messages to and from the device, which for most devices
+    /// are their reports: those packed by a server, or received by a
+    /// remote.  reports_per_second is averaged since the last call (or
+    /// since the object was made), and last_report_age is how many seconds
+    /// ago the latest one was sent or arrived (-1 if there hasn't been one).
+    /// Returns -1 if we have no connection.
+    int get_report_stats(double *reports_per_second, double *last_report_age);
+
     bool shutup; // if True, don't print the "No response from server" messages.
 
     friend class SendTextMessageBoundCall;
@@ -293,20 +306,17 @@ private:
 
     int d_first_mainloop; ///< First time client_mainloop() or server_mainloop()
     /// called?
-    struct timeval d_time_first_ping; ///< When was the first ping of this
-    /// unanswered group sent?
+    vrpn_BaseClassHeartbeat *d_heartbeat; ///< Pings the server for all of
+    /// the client objects on our connection
     struct timeval
         d_time_last_warned; ///< When is the last time we sent a warning?
-    int d_unanswered_ping;  ///< Do we have an outstanding ping request?
     int d_flatline;         ///< Has it been 10+ seconds without a response?
 
-    /// Used by client/server code to request/send "server is alive" (pong)
-    /// message
+    vrpn_uint32 d_report_stats_count; ///< As of the last get_report_stats()
+    struct timeval d_report_stats_time;
+
+    /// Used by server code to send "server is alive" (pong) message
     static int VRPN_CALLBACK handle_ping(void *userdata, vrpn_HANDLERPARAM p);
-    static int VRPN_CALLBACK handle_pong(void *userdata, vrpn_HANDLERPARAM p);
-    static int VRPN_CALLBACK
-    handle_connection_dropped(void *userdata, vrpn_HANDLERPARAM p);
-    void initiate_ping_cycle(void);
 };
 
 //---------------------------------------------------------------
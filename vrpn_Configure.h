@@ -48,6 +48,37 @@
 // Use Winsock2 library rather than Winsock.
 //#define	VRPN_USE_WINSOCK2
 
+//-----------------------
+// On Linux, have server connections wait on all of their sockets at
+// once using epoll, rather than having each client's endpoint select()
+// on its own sockets every time through mainloop().
+#if defined(linux) && !defined(__APPLE__)
+#define VRPN_USE_EPOLL
+#endif
+
+//-----------------------
+// On Linux, have server connections hand the pending UDP reports for all
+// of their clients to the kernel in a single sendmmsg() call.
+#if defined(linux) && !defined(__APPLE__)
+#define VRPN_USE_MMSG
+#endif
+
+//-----------------------
+// On Linux, let servers and clients on the same machine talk through a
+// shared-memory segment rather than over TCP and UDP, when they use
+// connection names like "shm:tracker_box".
+#if defined(linux) && !defined(__APPLE__)
+#define VRPN_USE_SHM
+#endif
+
+//-----------------------
+// On Linux, let servers and clients on the same machine talk over
+// Unix-domain sockets rather than TCP and UDP, when they use connection
+// names like "unix:/tmp/vrpn_tracker".
+#if defined(linux) && !defined(__APPLE__)
+#define VRPN_USE_UNIX_SOCKETS
+#endif
+
 //-----------------------
 // Instructs VRPN to expose the vrpn_gettimeofday() function also
 // as gettimeofday() so that external programs can use it.  This
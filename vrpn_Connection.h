@@ -8,11 +8,21 @@
 #include "vrpn_Types.h"     // for vrpn_int32, vrpn_uint32, etc
 #include "vrpn_EndpointContainer.h"
 
+#include <deque>  // for deque
+#include <vector> // for vector
+
 #if !(defined(_WIN32) && defined(VRPN_USE_WINSOCK_SOCKETS))
 #include <sys/select.h> // for fd_set
 #endif
 
+#ifdef VRPN_USE_MMSG
+#include <netinet/in.h> // for sockaddr_in
+struct mmsghdr;
+struct iovec;
+#endif
+
 struct timeval;
+class vrpn_SharedMessage;
 
 // Don't complain about using sprintf() when using Visual Studio.
 #ifdef _MSC_VER
@@ -54,6 +64,74 @@ typedef int(VRPN_CALLBACK *vrpn_MESSAGEHANDLER)(void *userdata,
 /// handler
 typedef vrpn_MESSAGEHANDLER vrpn_LOGFILTER;
 
+/// @brief A bounded queue of messages going from exactly one producer thread
+/// to exactly one consumer thread.
+///
+/// It passes messages from the logging thread in vrpn_Imager_Stream_Buffer,
+/// and from threads that pack messages into a connection that another thread
+/// runs (see vrpn_Connection::defer_messages_from_this_thread()).  Each slot
+/// keeps the buffer it was last given, so once the queue has warmed up
+/// inserting a message is a copy into memory that is already there, and
+/// neither side takes a lock: the producer only writes d_head and the
+/// consumer only writes d_tail.  The producer blocks when the ring is full,
+/// until the consumer has emptied half of it; nobody blocks otherwise.
+/// On compilers without atomics (see vrpn_Thread.h), the indices are read
+/// and written under a semaphore instead.
+class VRPN_API vrpn_Message_Ring {
+public:
+    /// The capacity is rounded up to a power of two.
+    vrpn_Message_Ring(vrpn_uint32 capacity = 128);
+    ~vrpn_Message_Ring(void);
+
+    /// Number of messages in the queue.  Either thread may call this.
+    vrpn_uint32 size(void) const;
+
+    /// Producer: copies the message and its payload into the back of the
+    /// queue, waiting for room if it is full.  Returns false if the payload
+    /// could not be allocated.
+    bool insert_back(const vrpn_HANDLERPARAM &p,
+                     vrpn_uint32 class_of_service = 0);
+
+    /// Consumer: points p at the message at the front of the queue, whose
+    /// buffer stays valid until pop_front() is called.  Returns false if
+    /// the queue is empty.
+    bool peek_front(vrpn_HANDLERPARAM *p,
+                    vrpn_uint32 *class_of_service = NULL);
+
+    /// Consumer: removes the message at the front of the queue.
+    void pop_front(void);
+
+    /// Consumer: discards everything in the queue.
+    void clear(void);
+
+protected:
+    struct Slot {
+        vrpn_HANDLERPARAM p;
+        vrpn_uint32 class_of_service;
+        char *buffer;
+        vrpn_uint32 buffer_size;
+    };
+    Slot *d_slots;
+    vrpn_uint32 d_mask; //< Capacity - 1
+
+    volatile vrpn_uint32 d_head; //< Count of messages inserted
+    volatile vrpn_uint32 d_tail; //< Count of messages popped
+    volatile vrpn_uint32 d_producer_waiting;
+    vrpn_Semaphore d_room; //< Producer waits here when the ring is full
+#ifndef VRPN_HAVE_ATOMICS
+    mutable vrpn_Semaphore d_index_sem;
+#endif
+
+    vrpn_uint32 load(const volatile vrpn_uint32 *v) const;
+    void store(volatile vrpn_uint32 *v, vrpn_uint32 val);
+    vrpn_uint32 exchange(volatile vrpn_uint32 *v, vrpn_uint32 val);
+
+private:
+    // Not copyable
+    vrpn_Message_Ring(const vrpn_Message_Ring &);
+    vrpn_Message_Ring &operator=(const vrpn_Message_Ring &);
+};
+
 /// VRPN buffers are aligned on 8 byte boundaries so that we can pack and
 /// unpack doubles into them on architectures that cannot handle unaligned
 /// access.
@@ -63,6 +141,10 @@ const unsigned vrpn_ALIGN = 8;
 /// to have large tables.  We need at least 150-200 for the microscope
 /// project as of Jan 98, and will eventually need two to three times that
 /// number.
+/// The connection's own sender and type tables now grow as needed, so
+/// these no longer limit how many can be registered; they remain as the
+/// size of tables kept per type outside the connection (such as by
+/// vrpn_RedundantReceiver) and as the bound on system message types.
 /// @{
 const int vrpn_CONNECTION_MAX_SENDERS = 2000;
 const int vrpn_CONNECTION_MAX_TYPES = 2000;
@@ -85,19 +167,33 @@ const int vrpn_ANY_TYPE = -1;
 /// UDP is set based on Ethernet maximum transmission size;  trying
 /// to send a message via UDP which is longer than the MTU of any
 /// intervening physical network may cause untraceable failures,
-/// so for now we do not expose any way to change the UDP output
-/// buffer size.  (MTU = 1500 bytes, - 28 bytes of IP+UDP header)
+/// so this is the size used unless both ends of a connection ask for
+/// larger datagrams using vrpn_Connection::set_udp_datagram_size().
+/// (MTU = 1500 bytes, - 28 bytes of IP+UDP header)
 /// @{
 
 const int vrpn_CONNECTION_TCP_BUFLEN = 64000;
 const int vrpn_CONNECTION_UDP_BUFLEN = 1472;
+const int vrpn_CONNECTION_UDP_MAX_BUFLEN = 65507; ///< Largest IPv4 datagram
 /// @}
 
+/// @brief Most UDP datagrams an endpoint fills before sending them, and most
+/// it reads in one system call, when built with VRPN_USE_MMSG.
+
+const int vrpn_CONNECTION_UDP_BATCH = 16;
+
 /// @brief Number of endpoints that a server connection can have.  Arbitrary
 /// limit.
 
 const int vrpn_MAX_ENDPOINTS = 256;
 
+/// @brief How often, in seconds, each endpoint asks the other side what time
+/// it is, and how many of the answers it keeps to estimate the clock offset
+/// and round-trip time from.
+
+const int vrpn_CONNECTION_CLOCK_INTERVAL = 1;
+const int vrpn_CONNECTION_CLOCK_SAMPLES = 8;
+
 /// @name System message types
 /// @{
 const vrpn_int32 vrpn_CONNECTION_SENDER_DESCRIPTION = (-1);
@@ -105,6 +201,10 @@ const vrpn_int32 vrpn_CONNECTION_TYPE_DESCRIPTION = (-2);
 const vrpn_int32 vrpn_CONNECTION_UDP_DESCRIPTION = (-3);
 const vrpn_int32 vrpn_CONNECTION_LOG_DESCRIPTION = (-4);
 const vrpn_int32 vrpn_CONNECTION_DISCONNECT_MESSAGE = (-5);
+const vrpn_int32 vrpn_CONNECTION_INTEREST_DESCRIPTION = (-6);
+const vrpn_int32 vrpn_CONNECTION_MULTICAST_DESCRIPTION = (-7);
+const vrpn_int32 vrpn_CONNECTION_CLOCK_QUERY = (-8);
+const vrpn_int32 vrpn_CONNECTION_CLOCK_REPLY = (-9);
 /// @}
 
 /// Classes of service for messages, specify multiple by ORing them together
@@ -120,8 +220,45 @@ const vrpn_uint32 vrpn_CONNECTION_LOW_LATENCY = (1 << 2);
 const vrpn_uint32 vrpn_CONNECTION_FIXED_THROUGHPUT = (1 << 3);
 const vrpn_uint32 vrpn_CONNECTION_HIGH_THROUGHPUT = (1 << 4);
 
+/// Not a class of service, but a promise from the sender that the message
+/// buffer will stay unchanged until the next call to mainloop() or
+/// send_pending_reports() on the connection.  Large reliable messages are
+/// then sent straight from that buffer rather than being copied into the
+/// outgoing queue first.  Ignored where it can't be honored, and for
+/// messages shorter than vrpn_CONNECTION_NO_COPY_MIN_PAYLOAD, which are
+/// cheaper to copy.  See also vrpn_Connection::send_no_copy_payloads().
+const vrpn_uint32 vrpn_CONNECTION_NO_COPY = (1 << 5);
+const vrpn_uint32 vrpn_CONNECTION_NO_COPY_MIN_PAYLOAD = 1024;
+
 /// @}
 
+/// @name What to do when a remote connection can't keep up
+///
+/// Passed to vrpn_Connection::set_send_policy().  With anything other
+/// than vrpn_SEND_QUEUE_BLOCK, sending never waits on the network: what
+/// the socket won't take now stays queued for the next mainloop(), and
+/// the policy decides what gives once that queue is full.  RELIABLE
+/// messages are never dropped; if one won't fit, the connection is.
+/// @{
+const int vrpn_SEND_QUEUE_BLOCK = (0); ///< Wait for the client (default)
+const int vrpn_SEND_QUEUE_DROP_OLDEST =
+    (1); ///< Drop the oldest unsent non-RELIABLE messages to make room
+const int vrpn_SEND_QUEUE_DROP_NEWEST =
+    (2); ///< Queue is capped; non-RELIABLE messages that don't fit are lost
+const int vrpn_SEND_QUEUE_DISCONNECT = (3); ///< Drop the client
+/// @}
+
+/// @brief Counters for the queue of messages waiting to go out over the
+/// reliable (TCP) channel to one remote connection.
+struct vrpn_SendQueueStats {
+    vrpn_uint32 queued_bytes;     ///< Bytes waiting to be sent right now
+    vrpn_uint32 queued_messages;  ///< Messages (or parts of one) waiting
+    vrpn_uint32 max_queued_bytes; ///< Most bytes that have been waiting
+    vrpn_uint32 partial_sends;    ///< Times the socket wouldn't take them all
+    vrpn_uint32 dropped_messages; ///< Messages thrown away by the policy
+    vrpn_uint32 dropped_bytes;    ///< Bytes in those messages
+};
+
 /// @name What to log
 /// @{
 const long vrpn_LOG_NONE = (0);
@@ -129,6 +266,68 @@ const long vrpn_LOG_INCOMING = (1 << 0);
 const long vrpn_LOG_OUTGOING = (1 << 1);
 /// @}
 
+/// @name Defaults for vrpn_Log::setStreaming()
+/// @{
+const vrpn_uint32 vrpn_LOG_STREAM_BUFFER_SIZE = (1024 * 1024);
+const vrpn_uint32 vrpn_LOG_STREAM_NUM_BUFFERS = (8);
+/// @}
+
+/// @brief Counters for a log that is being written to disk by a background
+/// thread as it goes (see vrpn_Log::setStreaming()).
+struct vrpn_LogStreamStats {
+    vrpn_uint32 records_written;    ///< Messages written to the file so far
+    vrpn_uint32 records_dropped;    ///< Lost because every buffer was full
+    vrpn_uint32 bytes_dropped;      ///< Bytes in those messages
+    vrpn_uint32 backlogged_records; ///< Logged but not yet written
+    vrpn_uint32 max_backlogged_records; ///< Most that have been waiting
+    vrpn_uint32 write_errors;       ///< Buffers that failed to write
+};
+
+/// @name Performance counters
+///
+/// Every connection counts the messages it sends and receives for each of
+/// its message types and senders, and for each remote connection.  The
+/// counters are always on; they cost a few additions per message, plus
+/// reading the clock around the handlers for each user message received.
+/// Counts wrap around rather than saturate, so take differences.
+/// @{
+
+/// Handler times are kept as a histogram: bucket 0 counts calls that took
+/// under a microsecond, bucket i those that took under 2^i microseconds
+/// (and at least half that), and the last bucket everything longer.
+const int vrpn_STATS_CALLBACK_BUCKETS = 16;
+
+/// @brief Counters for one message type or sender.
+struct vrpn_MessageStats {
+    vrpn_uint32 messages_in;  ///< User messages received from other sides
+    vrpn_uint32 bytes_in;     ///< Bytes in their payloads
+    vrpn_uint32 messages_out; ///< User messages packed to send
+    vrpn_uint32 bytes_out;    ///< Bytes in their payloads
+    timeval last_in;          ///< When the last one arrived (0 if none)
+    timeval last_out;         ///< msg_time of the last one packed (0 if none)
+    vrpn_uint32 callback_usecs[vrpn_STATS_CALLBACK_BUCKETS];
+    ///< How long the handlers for those received took
+};
+
+/// @brief Counters for one remote connection.  These include system
+/// messages, and outgoing ones only count if they were going to be sent
+/// (the other side wanted them).
+struct vrpn_EndpointStats {
+    vrpn_uint32 messages_in;  ///< Messages received
+    vrpn_uint32 bytes_in;     ///< Bytes in their payloads
+    vrpn_uint32 messages_out; ///< Messages packed to send
+    vrpn_uint32 bytes_out;    ///< Bytes in their payloads
+    vrpn_uint32 waits;        ///< Times mainloop() waited for it (select/epoll)
+    vrpn_uint32 tcp_reads;    ///< recv() calls on its TCP socket
+    vrpn_uint32 udp_reads;    ///< recv() or recvmmsg() calls on its UDP socket
+    vrpn_SendQueueStats send_queue;
+};
+
+/// How often, in seconds, a connection sends vrpn_connection_stats to
+/// those remote connections that have a handler for it.
+const int vrpn_CONNECTION_STATS_INTERVAL = 1;
+/// @}
+
 // If defined, will filter out messages:  if the remote side hasn't
 // registered a type, messages of that type won't be sent over the
 // link.  WARNING:  auto-type-registration breaks this.
@@ -143,6 +342,17 @@ extern VRPN_API const char *vrpn_dropped_connection;
 extern VRPN_API const char *vrpn_dropped_last_connection;
 /// @}
 
+/// @brief The message type, from sender vrpn_CONTROL, that carries a
+/// connection's performance counters to remote connections that ask for
+/// them.  Unpack it with vrpn_Connection::decode_stats().
+extern VRPN_API const char *vrpn_connection_stats;
+
+/// @brief The message types, from sender vrpn_CONTROL, that ask the other
+/// side which of its senders have handlers for a message type, and carry
+/// its answer.  See vrpn_Connection::query_handlers().
+extern VRPN_API const char *vrpn_handlers_query;
+extern VRPN_API const char *vrpn_handlers_reply;
+
 /// @brief vrpn_CONTROL is the sender used for notification messages sent to the
 /// user
 /// from the local VRPN implementation (got_first_connection, etc.)
@@ -154,6 +364,46 @@ extern VRPN_API const char *vrpn_CONTROL;
 /// @brief Length of names within VRPN
 typedef char cName[100];
 
+/// @brief The contents of a vrpn_connection_stats message, as unpacked by
+/// vrpn_Connection::decode_stats().  Names are those on the connection
+/// that sent it.
+struct vrpn_StatsReport {
+    struct Named {
+        cName name;
+        vrpn_MessageStats stats;
+    };
+#ifdef _MSC_VER
+#pragma warning(push)
+// Disable "need dll interface" warning on these members
+#pragma warning(disable : 4251)
+#endif
+    std::vector<Named> types;   ///< Those that have had any traffic
+    std::vector<Named> senders; ///< Those that have had any traffic
+    std::vector<vrpn_EndpointStats> endpoints;
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+};
+
+/// @brief The contents of a vrpn_handlers_reply message, as unpacked by
+/// vrpn_Connection::decode_handlers_reply().  Names are those on the
+/// connection that sent it.
+struct vrpn_HandlersReport {
+    struct Named {
+        cName name;
+    };
+    cName type; ///< The message type that was asked about
+#ifdef _MSC_VER
+#pragma warning(push)
+// Disable "need dll interface" warning on these members
+#pragma warning(disable : 4251)
+#endif
+    std::vector<Named> senders; ///< Those with handlers for it
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+};
+
 /// Placed here so vrpn_FileConnection can use it too.
 struct VRPN_API vrpn_LOGLIST {
     vrpn_HANDLERPARAM data;
@@ -332,6 +582,35 @@ public:
     int pack_type_description(vrpn_int32 which);
     ///< Packs a type description.
 
+    void pack_all_descriptions(void);
+    ///< Packs descriptions of all of our senders and types, as is done
+    ///< when a connection is first made.
+
+    int update_interest(void);
+    ///< Packs a description of the (type, sender) pairs we have handlers
+    ///< for if they, or whether we are logging incoming messages, have
+    ///< changed since the last one we sent.  Returns -1 on failure.
+
+    bool remote_wants(vrpn_int32 type, vrpn_int32 sender);
+    ///< False if the other side has told us it has no handlers for this
+    ///< user message, so there is no point in sending it.
+
+    bool remote_asked_for(vrpn_int32 type, vrpn_int32 sender);
+    ///< True only if the other side has told us it has a handler for this
+    ///< type itself (not just for any type).
+
+    int update_clock(void);
+    ///< Packs a clock query if it has been vrpn_CONNECTION_CLOCK_INTERVAL
+    ///< since the last one.  Returns -1 on failure.
+
+    bool clock_estimate(double *round_trip, double *offset) const;
+    ///< Fills in the round-trip time and how far the other side's clock
+    ///< is ahead of ours, in seconds.  False if there is no estimate yet.
+
+    virtual void get_stats(vrpn_EndpointStats *stats) const;
+    ///< Fills in our traffic counters.  The send queue ones are zero
+    ///< unless we send through one.
+
     /// @}
     int status;
 
@@ -368,12 +647,18 @@ public:
     handle_sender_message(void *userdata, vrpn_HANDLERPARAM p);
     static int VRPN_CALLBACK
     handle_type_message(void *userdata, vrpn_HANDLERPARAM p);
+    static int VRPN_CALLBACK
+    handle_interest_message(void *userdata, vrpn_HANDLERPARAM p);
+    static int VRPN_CALLBACK
+    handle_clock_query(void *userdata, vrpn_HANDLERPARAM p);
+    static int VRPN_CALLBACK
+    handle_clock_reply(void *userdata, vrpn_HANDLERPARAM p);
     /// @}
 
     /// @name Routines to inform the endpoint of the connection of
     /// which it is a part.
     /// @{
-    void setConnection(vrpn_Connection *conn) { d_parent = conn; }
+    void setConnection(vrpn_Connection *conn);
     vrpn_Connection *getConnection() { return d_parent; }
     /// @}
 
@@ -381,6 +666,11 @@ protected:
     virtual int dispatch(vrpn_int32 type, vrpn_int32 sender, timeval time,
                          vrpn_uint32 payload_len, char *bufptr);
 
+    void announce_connection(void);
+    ///< Counts the new connection and yanks the got-connection callbacks.
+    void announce_disconnection(void);
+    ///< Uncounts the connection and yanks the dropped-connection callbacks.
+
     int tryToMarshall(char *outbuf, vrpn_int32 &buflen, vrpn_int32 &numOut,
                       vrpn_uint32 len, timeval time, vrpn_int32 type,
                       vrpn_int32 sender, const char *buffer,
@@ -389,11 +679,14 @@ protected:
     ///< send_pending_reports() and then marshalls again.
     ///< Returns the number of characters successfully marshalled.
 
-    int marshall_message(char *outbuf, vrpn_uint32 outbuf_size,
-                         vrpn_uint32 initial_out, vrpn_uint32 len,
-                         struct timeval time, vrpn_int32 type,
-                         vrpn_int32 sender, const char *buffer,
-                         vrpn_uint32 sequenceNumber);
+public:
+    static int marshall_message(char *outbuf, vrpn_uint32 outbuf_size,
+                                vrpn_uint32 initial_out, vrpn_uint32 len,
+                                struct timeval time, vrpn_int32 type,
+                                vrpn_int32 sender, const char *buffer,
+                                vrpn_uint32 sequenceNumber);
+
+protected:
 
     // The senders and types we know about that have been described by
     // the other end of the connection.  Also, record the local mapping
@@ -404,6 +697,64 @@ protected:
     vrpn_TranslationTable *d_senders;
     vrpn_TranslationTable *d_types;
 
+    /// @name Which of our user messages the other side has handlers for
+    ///
+    /// Each side describes the (type, sender) pairs it has handlers for
+    /// in its own IDs.  Until a description arrives (older versions never
+    /// send one) everything is sent.  The pairs are mapped to our IDs
+    /// whenever they, or the mappings, change.
+    /// @{
+    void clear_interest(void);
+    void compile_interest(void);
+    struct vrpnInterest {
+        vrpnInterest(void)
+            : anySender(false)
+        {
+        }
+        bool anySender;
+        std::vector<vrpn_int32> senders; ///< Sorted
+    };
+    bool d_remoteInterestKnown;
+    bool d_remoteInterestAll;
+#ifdef _MSC_VER
+#pragma warning(push)
+// Disable "need dll interface" warning on these members
+#pragma warning(disable : 4251)
+#endif
+    std::vector<vrpn_int32> d_remoteInterest; ///< Their type, sender pairs
+    std::vector<vrpnInterest> d_interest;     ///< Indexed by our type
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+    bool d_interestDirty;
+
+    bool d_interestSent; ///< What we last told the other side
+    vrpn_uint32 d_interestChanges;
+    bool d_interestLogged;
+    /// @}
+
+    /// @name How far the other side's clock is from ours
+    ///
+    /// Each side sends a vrpn_CONNECTION_CLOCK_QUERY stamped with its own
+    /// clock every vrpn_CONNECTION_CLOCK_INTERVAL seconds, and the other
+    /// answers at once with a vrpn_CONNECTION_CLOCK_REPLY stamped with its
+    /// clock.  As in NTP, each exchange gives a round-trip time and an
+    /// offset; the offset is believed from whichever of the last
+    /// vrpn_CONNECTION_CLOCK_SAMPLES exchanges had the shortest round trip,
+    /// since that one was delayed least on its way either way.  Older
+    /// versions don't answer, so there is never an estimate for them.
+    /// @{
+    void clear_clock(void);
+    timeval d_clockLastQuery;
+    double d_clockRoundTrip[vrpn_CONNECTION_CLOCK_SAMPLES];
+    double d_clockOffset[vrpn_CONNECTION_CLOCK_SAMPLES];
+    int d_clockSamples; ///< How many exchanges since we connected
+    int d_clockBest;    ///< Which sample the estimate comes from
+    timeval d_clockOffsetTime; ///< The estimated offset, as a timeval
+    /// @}
+
+    vrpn_EndpointStats d_stats; ///< Kept up to date by us and subclasses
+
     vrpn_TypeDispatcher *d_dispatcher;
     vrpn_int32 *d_connectionCounter;
 
@@ -451,12 +802,23 @@ public:
                      vrpn_int32 sender, const char *buffer,
                      vrpn_uint32 class_of_service);
 
+    /// @brief Pack a message that the connection has already marshalled
+    /// for all of its endpoints; only our sequence number is filled in.
+    int pack_shared_message(vrpn_SharedMessage *msg,
+                            vrpn_uint32 class_of_service);
+
     /// @brief send pending report, clear the buffer.
     ///
     /// This function was protected, now is public, so we can use it
     /// to send out intermediate results without calling mainloop
     virtual int send_pending_reports(void);
 
+    int send_pending_tcp(void);
+    ///< The TCP half of send_pending_reports().  Returns -1 on failure.
+    bool holds_caller_payloads(void) const;
+    ///< True if the TCP queue still refers to the buffer of a message
+    ///< that was packed with vrpn_CONNECTION_NO_COPY.
+
     int pack_udp_description(int portno);
 
     int handle_tcp_messages(const timeval *timeout);
@@ -472,6 +834,15 @@ public:
     ///< on failure.
 
     vrpn_int32 set_tcp_outbuf_size(vrpn_int32 bytecount);
+    ///< Sets the size of the TCP output queue, keeping anything that is
+    ///< waiting in it.  Returns the new size, or -1 if it won't fit.
+    vrpn_int32 set_udp_datagram_size(vrpn_int32 bytecount);
+    ///< Sets the largest UDP datagram sent or received, reallocating the
+    ///< UDP buffers.  Returns the new size, or -1 if anything is waiting
+    ///< to go out or we ran out of memory.
+
+    void get_send_queue_stats(vrpn_SendQueueStats *stats) const;
+    virtual void get_stats(vrpn_EndpointStats *stats) const;
 
     int setup_new_connection(void);
     ///< Sends the magic cookie and other information to its
@@ -521,9 +892,136 @@ public:
     ///< end to open a UDP link to their counterparts.  If this is
     ///< the case, then this flag should be set to true.
 
+    /// @name Multicast.  On a server, whether we have offered the other side
+    /// our multicast group and whether it has joined, in which case it no
+    /// longer gets its own UDP copies.  On a client that has joined, the
+    /// group's socket replaces d_udpInboundSocket and d_udpMulticastSession
+    /// is nonzero.
+    /// @{
+    int join_multicast(const char *group, unsigned short port,
+                       vrpn_uint32 session);
+    ///< Returns 0 on success, -1 if we can't join (which is not an error).
+    bool d_udpMulticastOffered;
+    bool d_udpMulticast;
+    vrpn_uint32 d_udpMulticastSession;
+    SOCKET d_udpUnicastSocket;
+    ///< Our own UDP port, left open (but unread) once we have joined so
+    ///< that the server's last few datagrams there don't bounce.
+    /// @}
+
+    /// @name Unix-domain sockets.  A client whose server is named
+    /// "unix:/path" connects d_tcpSocket straight to that path.  The server
+    /// then hands it one end of an AF_UNIX SOCK_SEQPACKET pair, which both
+    /// sides use as d_udpOutboundSocket and d_udpInboundSocket for their
+    /// LOW_LATENCY messages.  d_tcp_only is set, so no UDP is negotiated.
+    /// @{
+    int connect_unix_to(const char *path);
+    ///< Connects d_tcpSocket to the server listening at path;
+    ///< sets status to COOKIE_PENDING;  returns 0 on success, -1 on failure
+    int send_unix_channel(void);
+    ///< Server side: sends the other side its end of a new SOCK_SEQPACKET
+    ///< pair, ahead of our cookie.  Returns 0 on success, -1 on failure.
+    int receive_unix_channel(void);
+    ///< Client side: picks up the end of the pair the server sent.
+    ///< Returns 0 on success, -1 on failure.
+    int use_unix_channel(SOCKET sock);
+    void set_unix_path(char *path);
+    ///< Client side: the path our server listens at, which we connect (and
+    ///< reconnect) to.  We take it over; it must come from new [].
+    /// @}
+
+#ifdef VRPN_USE_EPOLL
+    /// @name Used when vrpn_Connection_IP waits on all of its sockets at
+    /// once with epoll, rather than having each endpoint select() on its own.
+    /// @{
+    int epoll_prepare(int epoll_fd);
+    ///< Sends any pending reports and adds sockets opened since the last
+    ///< call to the epoll set.  Returns nonzero if this endpoint needs to
+    ///< be serviced without waiting (it is still connecting, or it already
+    ///< has a complete message buffered).
+    int epoll_service(const SOCKET *ready, int num_ready);
+    ///< Handles incoming messages on whichever of this endpoint's sockets
+    ///< are in the list of those found to be ready.
+    ///< Returns -1 and sets status to BROKEN on failure.
+    SOCKET d_epollTcpSocket; ///< TCP socket currently in the epoll set
+    SOCKET d_epollUdpSocket; ///< UDP inbound socket currently in the set
+    /// @}
+#endif
+
+#ifdef VRPN_USE_MMSG
+    /// @name Used when vrpn_Connection_IP sends the UDP reports for all of
+    /// its endpoints with a single sendmmsg() call.
+    /// @{
+    bool pending_udp_datagram(struct mmsghdr *msg, struct iovec *iov);
+    ///< If there is a UDP report waiting to go, points msg (and iov) at it
+    ///< and at the address it is going to and returns true.
+    ///< Only a single datagram is offered; if several have built up, the
+    ///< endpoint sends them itself with one sendmmsg() call.
+    void udp_datagram_sent(void) { d_udpNumOut = 0; }
+    struct sockaddr_in d_udpPeer; ///< Where d_udpOutboundSocket sends
+    bool d_udpPeerValid;
+    /// @}
+#endif
+
 protected:
-    int getOneTCPMessage(int fd, char *buf, size_t buflen);
+    int pack_message(vrpn_uint32 len, timeval time, vrpn_int32 type,
+                     vrpn_int32 sender, const char *buffer,
+                     vrpn_uint32 class_of_service, vrpn_SharedMessage *shared);
+    ///< Does the work of pack_message() and pack_shared_message(); shared
+    ///< is NULL if the message hasn't been marshalled yet.
+    int marshall_or_copy(char *outbuf, vrpn_int32 buflen, vrpn_int32 numOut,
+                         vrpn_uint32 len, timeval time, vrpn_int32 type,
+                         vrpn_int32 sender, const char *buffer,
+                         vrpn_uint32 sequenceNumber,
+                         const vrpn_SharedMessage *shared);
+    ///< Like marshall_message(), but copies a message that has already
+    ///< been marshalled rather than doing it again.
+    int queue_full(vrpn_uint32 len, timeval time, vrpn_int32 type,
+                   vrpn_int32 sender, const char *buffer,
+                   vrpn_uint32 class_of_service, vrpn_SharedMessage *shared);
+    ///< Applies the connection's send policy when a message won't fit in
+    ///< the TCP output queue.
+    bool drop_oldest_unreliable(void);
+    void tcp_queue_sent(vrpn_int32 sent);
+    ///< Removes what has gone out from the front of the TCP queue.
+    int pack_tcp_no_copy(vrpn_uint32 len, timeval time, vrpn_int32 type,
+                         vrpn_int32 sender, const char *buffer,
+                         vrpn_uint32 class_of_service,
+                         vrpn_SharedMessage *shared);
+    ///< Queues only the header, leaving the payload in the caller's
+    ///< buffer to be sent from there (vrpn_CONNECTION_NO_COPY), or in
+    ///< the shared message, which we hold on to until it has gone.
+    void copy_tcp_payloads(void);
+    ///< Copies any payloads still waiting to go out of the callers'
+    ///< buffers, once we can no longer count on them being there.
+    vrpn_int32 tcp_queued_bytes(void) const
+    {
+        return d_tcpNumOut + d_tcpExternalOut;
+    }
+
+    int getOneTCPMessage(void);
+    ///< Dispatches the first message in the TCP receive buffer.
+    ///< Returns 1 if a message was handled, 0 if the buffer does not
+    ///< yet hold a complete message, -1 on error.
     int getOneUDPMessage(char *buf, size_t buflen);
+    int dispatch_udp_datagram(char *buf, int len);
+    ///< Dispatches each message in a received datagram.  Returns the
+    ///< number of messages, or -1 on error.
+    int pack_udp_message(vrpn_uint32 len, timeval time, vrpn_int32 type,
+                         vrpn_int32 sender, const char *buffer,
+                         const vrpn_SharedMessage *shared);
+    ///< Marshals into the current UDP datagram, starting another one
+    ///< when it is full.  Returns the bytes packed, 0 on failure.
+    int send_udp_datagrams(void);
+    ///< Sends every UDP datagram that has been filled.  Returns -1 on
+    ///< failure.
+    char *udp_datagram(int which) const
+    {
+        return d_udpOutbuf + which * d_udpBuflen;
+    }
+
+    bool tcp_message_buffered(void) const;
+    ///< True if a complete message is waiting in the TCP receive buffer.
 
     SOCKET d_udpOutboundSocket;
     SOCKET d_udpInboundSocket;
@@ -538,20 +1036,71 @@ protected:
     vrpn_int32 d_tcpBuflen;
     vrpn_int32 d_udpBuflen;
     vrpn_int32 d_tcpNumOut;
-    vrpn_int32 d_udpNumOut;
+    vrpn_int32 d_udpNumOut; ///< Bytes in the datagram being filled
+    vrpn_int32 d_tcpExternalOut; ///< Queued payload bytes not in d_tcpOutbuf
+
+    /// d_udpOutbuf holds d_udpSlots datagrams of d_udpBuflen bytes each;
+    /// the d_udpSealed full ones are followed by the one being filled.
+    /// The receive buffer is split into the same number of slots.
+    vrpn_int32 d_udpSlots;
+    vrpn_int32 d_udpSealed;
+    vrpn_int32 d_udpSealedLen[vrpn_CONNECTION_UDP_BATCH];
+
+    /// One entry per message in d_tcpOutbuf, oldest first, so that we can
+    /// find the message boundaries when deciding what to drop.  Each goes
+    /// out as its bytes in d_tcpOutbuf followed by its payload, if that
+    /// was left in the sender's buffer.
+    struct QueuedMessage {
+        QueuedMessage(vrpn_int32 l, bool d)
+            : len(l)
+            , droppable(d)
+            , payload(NULL)
+            , payload_len(0)
+            , pad(0)
+            , owned(NULL)
+            , shared(NULL)
+        {
+        }
+        void release(void); ///< Frees owned and lets go of shared
+        vrpn_int32 len;  ///< Bytes of it still in d_tcpOutbuf
+        bool droppable; ///< Not RELIABLE, and none of it has been sent
+        const char *payload;    ///< Rest of a payload not in d_tcpOutbuf
+        vrpn_int32 payload_len; ///< Bytes still to go at payload
+        vrpn_int32 pad;         ///< Alignment bytes to follow the payload
+        char *owned; ///< Our copy of the payload, if we had to make one
+        vrpn_SharedMessage *shared; ///< Holds payload, if it was shared
+    };
+#ifdef _MSC_VER
+#pragma warning(push)
+// Disable "need dll interface" warning on these members
+#pragma warning(disable : 4251)
+#endif
+    std::deque<QueuedMessage> d_tcpQueue;
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+    vrpn_SendQueueStats d_sendStats;
 
     vrpn_int32 d_tcpSequenceNumber;
     vrpn_int32 d_udpSequenceNumber;
 
+    /// TCP data is pulled off the socket in as large a chunk as is
+    /// available and messages are dispatched in place from this buffer.
+    /// It holds two full-sized messages so that the tail of one read
+    /// never prevents the next from being pulled in.
     vrpn_float64
-        d_tcpAlignedInbuf[vrpn_CONNECTION_TCP_BUFLEN / sizeof(vrpn_float64) +
-                          1];
-    vrpn_float64
-        d_udpAlignedInbuf[vrpn_CONNECTION_UDP_BUFLEN / sizeof(vrpn_float64) +
+        d_tcpAlignedInbuf[2 * vrpn_CONNECTION_TCP_BUFLEN /
+                              sizeof(vrpn_float64) +
                           1];
+    vrpn_float64 *d_udpAlignedInbuf;
     char *d_tcpInbuf;
     char *d_udpInbuf;
+    size_t d_udpInbufStride; ///< Bytes between receive slots, kept aligned
+    size_t d_tcpInbufStart; ///< Offset of the first unparsed byte
+    size_t d_tcpInbufEnd;   ///< Offset just past the last byte received
+    int d_tcpDispatchDepth; ///< Handlers running on messages in d_tcpInbuf
 
+    char *d_unixPath; ///< Where our server listens (clients only), or NULL
     char *d_NICaddress;
 };
 
@@ -636,6 +1185,28 @@ public:
     /// to send out intermediate results without calling mainloop
     virtual int send_pending_reports(void) = 0;
 
+    /// @brief Sends whatever still refers to the buffers of messages packed
+    /// with vrpn_CONNECTION_NO_COPY, so that they can be reused.  Unlike
+    /// send_pending_reports(), remote connections that aren't holding on
+    /// to one, and everything going by UDP, are left to go out at the
+    /// next mainloop() with the rest.
+    virtual int send_no_copy_payloads(void) { return send_pending_reports(); }
+
+    /// @brief Lets a thread other than the one that runs this connection
+    /// send messages through it.
+    ///
+    /// From now on, messages that the calling thread packs into this
+    /// connection are copied into the ring instead, and its calls to
+    /// mainloop() and send_pending_reports() do nothing.  The thread that
+    /// runs the connection packs them for real by calling
+    /// pack_deferred_messages() with the same ring.  Passing NULL goes back
+    /// to packing directly.  A thread can only defer to one connection at a
+    /// time.  Returns -1 if the compiler has no thread-local storage.
+    int defer_messages_from_this_thread(vrpn_Message_Ring *ring);
+    /// Packs the messages that are in the ring now; returns -1 if any of
+    /// them could not be packed (they are removed from the ring anyway).
+    int pack_deferred_messages(vrpn_Message_Ring *ring);
+
     /// Returns the time since the connection opened.
     /// Some subclasses may redefine time.
     virtual int time_since_connection_open(struct timeval *elapsed_time);
@@ -662,6 +1233,25 @@ public:
     /// Save any messages on any endpoints which have been logged so far.
     virtual int save_log_so_far();
 
+    /// @brief Has the logs on all endpoints, both those open now and those
+    /// made later, written to disk by a background thread as they go rather
+    /// than held in memory until save_log_so_far() or until they are closed.
+    /// See vrpn_Log::setStreaming().  Returns -1 if any log couldn't do it.
+    int set_log_streaming(vrpn_uint32 buffer_size = vrpn_LOG_STREAM_BUFFER_SIZE,
+                          vrpn_uint32 num_buffers = vrpn_LOG_STREAM_NUM_BUFFERS);
+    vrpn_uint32 get_log_stream_buffer_size(void) const
+    {
+        return d_log_stream_buffer_size;
+    };
+    vrpn_uint32 get_log_stream_num_buffers(void) const
+    {
+        return d_log_stream_num_buffers;
+    };
+
+    /// @brief Fills in the counters summed over the logs on all endpoints
+    /// (max_backlogged_records is the largest of any of them).
+    void get_log_stream_stats(vrpn_LogStreamStats *stats);
+
     /// vrpn_File_Connection implements this as "return this" so it
     /// can be used to detect a File_Connection and get the pointer for it
     virtual vrpn_File_Connection *get_File_Connection(void);
@@ -695,12 +1285,198 @@ public:
         return d_stop_processing_messages_after;
     };
 
+    /// @brief Estimates the round-trip time to the other side and how far
+    /// its clock is ahead of ours, both in seconds.
+    ///
+    /// Each remote connection keeps these up to date by exchanging a pair
+    /// of system messages with the other side every
+    /// vrpn_CONNECTION_CLOCK_INTERVAL seconds.  On a server, which
+    /// picks the client, counting from 0.  Returns false if there is no
+    /// estimate yet, which is always the case if the other side is an
+    /// older version of VRPN.  Connections through shared memory are
+    /// between processes on the same machine and don't estimate.
+    bool get_clock_estimate(double *round_trip, double *offset, int which = 0);
+
+    /// @brief If set, subtracts the estimated clock offset from the msg_time
+    /// of each user message that comes in, so that handlers see when it was
+    /// sent by our clock.  Off by default.
+    ///
+    /// Messages that come in before there is an estimate are left alone.
+    /// This lets code on one machine, like the prediction in
+    /// vrpn_Tracker_DeadReckoning_Rotation, know how old a report from
+    /// another really is.
+    void set_local_message_times(bool local) { d_local_message_times = local; };
+    bool get_local_message_times(void) const { return d_local_message_times; };
+
+    /// @brief Lets just one of the objects handling a message answer it.
+    ///
+    /// Every Remote for a device on this connection gets the same messages
+    /// from it, but a server that counts answers to a question (as
+    /// vrpn_Analog does its offer of compact reports) needs one per
+    /// connection.  Each handler calls this with the message's sender, type
+    /// and time, and any serial number the message carries; only the first
+    /// to ask about a given message gets true.
+    bool first_to_answer(vrpn_int32 sender, vrpn_int32 type,
+                         const timeval &msg_time, vrpn_int32 serial = 0);
+
+    /// @brief Choose what happens when a remote connection can't keep up
+    /// with the messages being sent to it: one of the vrpn_SEND_QUEUE_*
+    /// values.
+    ///
+    /// By default (vrpn_SEND_QUEUE_BLOCK), sending waits until every
+    /// packed message has been handed to the operating system, so a single
+    /// stalled client holds up mainloop() and with it every other client.
+    /// The other policies never wait; see vrpn_SEND_QUEUE_DROP_OLDEST etc.
+    void set_send_policy(int policy) { d_send_policy = policy; };
+    int get_send_policy(void) const { return d_send_policy; };
+
+    /// @brief Sets the size in bytes of the output queue to each remote
+    /// connection, both those open now and those made later.  This is the
+    /// queue whose filling up triggers the send policy.
+    void set_tcp_outbuf_size(vrpn_int32 bytecount);
+    vrpn_int32 get_tcp_outbuf_size(void) const { return d_tcp_outbuf_size; };
+
+    /// @brief Sets the largest UDP datagram that remote connections made
+    /// from now on may use, up to vrpn_CONNECTION_UDP_MAX_BUFLEN.
+    ///
+    /// Each side offers its size when the connection is set up and both use
+    /// the smaller, so this only takes effect when the other end asks for
+    /// large datagrams too.  Many small reports then go out (and, with
+    /// VRPN_USE_MMSG, come in) in far fewer system calls.  Datagrams larger
+    /// than the path MTU are fragmented by IP, and losing any fragment
+    /// loses the whole datagram, so this is best kept to fast local links.
+    void set_udp_datagram_size(vrpn_int32 bytecount);
+    vrpn_int32 get_udp_datagram_size(void) const
+    {
+        return d_udp_datagram_size;
+    };
+
+    /// @brief Fills in the output queue counters for the which'th remote
+    /// connection (counting from 0).  Returns -1 if there is no such
+    /// connection, so callers can loop until then.
+    int get_send_queue_stats(int which, vrpn_SendQueueStats *stats);
+
+    /// @brief Fills in the counters for one of our message types or senders.
+    /// Returns -1 if there is no such type or sender.
+    int get_type_stats(vrpn_int32 type, vrpn_MessageStats *stats);
+    int get_sender_stats(vrpn_int32 sender, vrpn_MessageStats *stats);
+
+    /// @brief Fills in the counters for the which'th remote connection
+    /// (counting from 0).  Returns -1 if there is no such connection.
+    int get_endpoint_stats(int which, vrpn_EndpointStats *stats);
+
+    /// @brief Unpacks the body of a vrpn_connection_stats message.
+    ///
+    /// Every vrpn_CONNECTION_STATS_INTERVAL seconds, a connection sends
+    /// the counters for its types and senders that have had any traffic,
+    /// and for all of its remote connections, to each remote connection
+    /// that has registered a handler for that type from vrpn_CONTROL.
+    /// This is how a tool like vrpn_print_stats watches a running server
+    /// without its help.  Returns -1 if the message is malformed.
+    static int decode_stats(const char *buf, vrpn_uint32 len,
+                            vrpn_StatsReport *report);
+
+    /// @brief Asks the other side of each remote connection which of its
+    /// senders have handlers for the named message type.
+    ///
+    /// Each answers with a vrpn_handlers_reply message from vrpn_CONTROL,
+    /// which decode_handlers_reply() unpacks; older versions of VRPN don't
+    /// answer, and neither does this connection's own side: objects on it
+    /// are local and can just ask.  vrpn_BaseClass asks about its ping
+    /// message this way to learn in one message which devices a server has.
+    /// Returns -1 on failure.
+    int query_handlers(const char *type_name);
+    static int decode_handlers_reply(const char *buf, vrpn_uint32 len,
+                                     vrpn_HandlersReport *report);
+
+    void count_message_in(vrpn_int32 type, vrpn_int32 sender, vrpn_uint32 len,
+                          const timeval &arrived, unsigned long usecs);
+    ///< Called by our endpoints for each user message whose handlers they
+    ///< have called (in usecs microseconds); type and sender are ours.
+
+    /// @brief Sends LOW_LATENCY messages once to a UDP multicast group
+    /// rather than once to each client.  Only server connections do this.
+    ///
+    /// Each client is told the group over its TCP link, which still
+    /// carries everything RELIABLE.  Those that manage to join it stop
+    /// getting their own UDP copies; older clients, and those that can't
+    /// join, carry on as before.  interface_address picks the network
+    /// interface to send on (use "127.0.0.1" to try it out on one
+    /// machine); by default it is the NIC the server listens on, if one
+    /// was given.  Returns 0 on success, -1 on failure.
+    virtual int enable_multicast(const char *group, unsigned short port,
+                                 const char *interface_address = NULL,
+                                 int ttl = 1);
+
 protected:
+    virtual int pack_group_message(vrpn_uint32 len, struct timeval time,
+                                   vrpn_int32 type, vrpn_int32 sender,
+                                   const char *buffer,
+                                   vrpn_uint32 class_of_service);
+    ///< Called by pack_message() after packing the message for each
+    ///< endpoint, so that a subclass can send it to all of them at once.
+
+    bool packing_deferred(void) const;
+    ///< True if the calling thread's messages to us go into a ring.
+
+    /// @name Performance counters
+    /// @{
+    void count_message_out(vrpn_int32 type, vrpn_int32 sender,
+                           vrpn_uint32 len, const timeval &time);
+    int publish_stats(void);
+    ///< Packs a vrpn_connection_stats message if it is time to and some
+    ///< remote connection has asked for them.  Returns -1 on failure.
+#ifdef _MSC_VER
+#pragma warning(push)
+// Disable "need dll interface" warning on these members
+#pragma warning(disable : 4251)
+#endif
+    std::vector<vrpn_MessageStats> d_type_stats;   ///< Indexed by our type
+    std::vector<vrpn_MessageStats> d_sender_stats; ///< Indexed by our sender
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+    vrpn_int32 d_stats_type;       ///< Our ID for vrpn_connection_stats
+    vrpn_int32 d_stats_sender;     ///< Our ID for vrpn_CONTROL
+    timeval d_stats_last_publish;
+    /// @}
+
+    vrpn_int32 d_handlers_query_type; ///< Our ID for vrpn_handlers_query
+    vrpn_int32 d_handlers_reply_type; ///< Our ID for vrpn_handlers_reply
+    bool d_querying_handlers; ///< Packing our own vrpn_handlers_query?
+    static int VRPN_CALLBACK
+    handle_handlers_query(void *userdata, vrpn_HANDLERPARAM p);
+
+    /// The last message that first_to_answer() said to answer, for each
+    /// sender and type it has been asked about.
+    struct AnsweredMessage {
+        vrpn_int32 sender;
+        vrpn_int32 type;
+        vrpn_int32 serial;
+        timeval msg_time;
+    };
+#ifdef _MSC_VER
+#pragma warning(push)
+// Disable "need dll interface" warning on these members
+#pragma warning(disable : 4251)
+#endif
+    std::vector<AnsweredMessage> d_answered;
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
     /// If this value is greater than zero, the connection should stop
     /// looking for new messages on a given endpoint after this many
     /// are found.
     vrpn_uint32 d_stop_processing_messages_after;
 
+    int d_send_policy;             ///< One of the vrpn_SEND_QUEUE_* values
+    bool d_local_message_times; ///< Move incoming times into our clock?
+    vrpn_int32 d_tcp_outbuf_size; ///< Output queue size for new endpoints
+    vrpn_int32 d_udp_datagram_size; ///< UDP size offered by new endpoints
+    vrpn_uint32 d_log_stream_buffer_size; ///< 0 if logs aren't streamed
+    vrpn_uint32 d_log_stream_num_buffers;
+
     int connectionStatus; ///< Status of the connection
 
     /// Redefining this and passing it to constructors
@@ -862,6 +1638,17 @@ public:
 
     virtual ~vrpn_Connection_IP(void);
 
+protected:
+    /// Make a server that listens for clients on the same machine at a
+    /// Unix-domain socket, rather than on a UDP and TCP port.  To access
+    /// this from user code, call vrpn_create_server_connection() with a
+    /// name like 'unix:/tmp/vrpn_tracker'.
+    vrpn_Connection_IP(const char *unix_path,
+                       const char *local_in_logfile_name,
+                       const char *local_out_logfile_name,
+                       vrpn_EndpointAllocator epa);
+
+public:
     /// This is similar to check connection except that it can be
     /// used to receive requests from before a server starts up
     virtual int connect_to_client(const char *machine, int port);
@@ -873,6 +1660,8 @@ public:
     /// Optional argument is TOTAL time to block on select() calls;
     /// there may be multiple calls to select() per call to mainloop(),
     /// and this timeout will be divided evenly between them.
+    /// A server built with VRPN_USE_EPOLL instead does a single wait
+    /// of up to this long on all of its sockets.
     virtual int mainloop(const struct timeval *timeout = NULL);
 
 protected:
@@ -896,11 +1685,15 @@ protected:
     /// @{
     SOCKET listen_udp_sock; ///< UDP Connect requests come here
     SOCKET listen_tcp_sock; ///< TCP Connection requests come here
+    SOCKET listen_unix_sock; ///< Unix-domain connections come here
+    char *d_unixPath;        ///< Path listen_unix_sock is bound to
     /// @}
 
     /// Routines that handle system messages
     static int VRPN_CALLBACK
     handle_UDP_message(void *userdata, vrpn_HANDLERPARAM p);
+    static int VRPN_CALLBACK
+    handle_multicast_message(void *userdata, vrpn_HANDLERPARAM p);
 
     /// @brief Called by all constructors
     void init(void);
@@ -910,12 +1703,17 @@ protected:
     /// This function was protected, now is public, so we can use it
     /// to send out intermediate results without calling mainloop
     virtual int send_pending_reports(void);
+    virtual int send_no_copy_payloads(void);
 
     //// This is called by a server-side process to see if there have
     //// been any UDP packets come in asking for a connection. If there
     //// are, it connects the TCP port and then calls handle_connection().
     virtual void
     server_check_for_incoming_connections(const struct timeval *timeout = NULL);
+    void server_check_for_unix_connections(void);
+    vrpn_Endpoint_IP *accept_endpoint(SOCKET sock);
+    ///< Makes a TCP-only endpoint for a client that has connected to one
+    ///< of our listen sockets, or closes the socket and returns NULL.
 
     /// This routine is called by a server-side connection when a
     /// new connection has just been established, and the tcp port
@@ -933,6 +1731,57 @@ protected:
     void drop_connection_and_compact(vrpn_Endpoint *endpoint);
 
     char *d_NIC_IP;
+
+#ifdef VRPN_USE_EPOLL
+    /// Servers register their listening sockets and all endpoint sockets
+    /// here, so that mainloop() can do a single wait on all of them and
+    /// service only the ones that are ready.  -1 if not in use.
+    int d_epollFd;
+
+    void init_epoll(void);
+    ///< Creates d_epollFd with the listen sockets in it.
+    int mainloop_epoll(const struct timeval *timeout);
+#endif
+
+#ifdef VRPN_USE_MMSG
+    /// Servers send the pending UDP reports for all of their endpoints
+    /// through this socket in one call.  INVALID_SOCKET if not in use.
+    /// One sendmmsg() call can only use one socket, so these reports come
+    /// from a different port than each endpoint's own outbound socket.
+    /// That is safe because clients read UDP on an unconnected socket that
+    /// takes datagrams from any port (the server's outbound ports are
+    /// ephemeral anyway, so nothing can filter on them), and the TCP
+    /// connection rather than UDP errors tells us when a client goes away.
+    SOCKET d_udpFanoutSocket;
+
+    void send_udp_batch(void);
+#endif
+
+public:
+    virtual int enable_multicast(const char *group, unsigned short port,
+                                 const char *interface_address = NULL,
+                                 int ttl = 1);
+
+protected:
+    /// @name Used by a server sending LOW_LATENCY messages to a multicast
+    /// group.  Each datagram starts with d_multicastSession, so clients
+    /// can tell our datagrams from those of any other server on the group.
+    /// @{
+    virtual int pack_group_message(vrpn_uint32 len, struct timeval time,
+                                   vrpn_int32 type, vrpn_int32 sender,
+                                   const char *buffer,
+                                   vrpn_uint32 class_of_service);
+    void offer_multicast(void);
+    ///< Tells newly-connected endpoints about the group.
+    int send_multicast(void);
+    SOCKET d_multicastSocket; ///< INVALID_SOCKET if not in use
+    char d_multicastGroup[64];
+    unsigned short d_multicastPort;
+    vrpn_uint32 d_multicastSession;
+    char *d_multicastOutbuf;
+    vrpn_int32 d_multicastNumOut;
+    vrpn_uint32 d_multicastSequenceNumber;
+    /// @}
 };
 
 /// @brief Constructor for a Loopback connection that will basically just
@@ -22,7 +22,9 @@
 // playback.
 // }}}
 
+#include <map>     // for map
 #include <stdio.h> // for NULL, FILE
+#include <vector>  // for vector
 
 #include "vrpn_Configure.h"  // for VRPN_API, VRPN_CALLBACK
 #include "vrpn_Connection.h" // for vrpn_LOGLIST (ptr only), etc
@@ -70,6 +72,48 @@ extern VRPN_API bool vrpn_FILE_CONNECTIONS_SHOULD_ACCUMULATE;
 
 extern VRPN_API bool vrpn_FILE_CONNECTIONS_SHOULD_SKIP_TO_USER_MESSAGES;
 
+// Global variable used to indicate whether File Connections should build
+// a time index of their log file the first time they are asked to jump
+// to a time or to report the length or user timestamps of the file.  The
+// index maps timestamps to offsets in the file, so that these operations
+// do not have to read through the whole file when it is not preloaded.
+// When the connection neither preloads nor accumulates, jumps seek past the
+// parts of the file that the index shows come before the time wanted.
+// Otherwise they skip over those parts of the list of messages in memory;
+// a jump forward past what has been read so far still has to read (and
+// keep) the messages in between.  If a sidecar index file (the log file name with ".vrpnidx" added)
+// that matches the log is found, it is read instead of scanning the log.
+// This defaults to "true".  The value is only checked at connection
+// creation time.
+
+extern VRPN_API bool vrpn_FILE_CONNECTIONS_SHOULD_INDEX;
+
+// Global variable used to indicate whether File Connections should write
+// the time index they build out to the sidecar file next to the log, so
+// that later opens of the same log can skip the scan.  This defaults to
+// "false".
+
+extern VRPN_API bool vrpn_FILE_CONNECTIONS_SHOULD_SAVE_INDEX;
+
+// Global variable used to indicate whether File Connections that preload
+// should map the log file into memory rather than reading it.  When they
+// do, the messages are parsed in place and their buffers point into the
+// mapping, so opening the file does not copy it and its pages are only
+// read from disk (or shared from the operating system's cache) as they
+// are played.  The file must not be truncated while it is being played.
+// Not available on Windows, where this is ignored.  This defaults to
+// "false".  The value is only checked at connection creation time.
+
+extern VRPN_API bool vrpn_FILE_CONNECTIONS_SHOULD_MMAP;
+
+// Offset of a record within a log file.  Long sessions produce files that
+// are larger than a long can address on some platforms.
+#ifdef _MSC_VER
+typedef __int64 vrpn_FileOffset;
+#else
+typedef long long vrpn_FileOffset;
+#endif
+
 class VRPN_API vrpn_File_Connection : public vrpn_Connection {
 public:
     vrpn_File_Connection(const char *station_name,
@@ -283,6 +327,78 @@ protected:
 
     virtual int close_file(void);
 
+    // Offset in the file of the record in d_logTail, and of the next
+    // record read_entry() will read.
+    vrpn_FileOffset d_tailOffset;
+    vrpn_FileOffset d_nextOffset;
+
+    // Reads the record at offset into d_logTail and makes it current.
+    // Only for use when not accumulating.
+    // returns 0 on success, 1 on EOF, -1 on error
+    int seek_entry(vrpn_FileOffset offset);
+
+    // }}}
+    // {{{ time index
+    //     The file is split into chunks of consecutive records.  For each
+    //     chunk we keep its offset in the file, the latest timestamp within
+    //     it and the latest timestamp up to its end, which lets a jump find
+    //     the chunk holding the first record past a given time by binary
+    //     search rather than by reading the records before it.  Timestamps
+    //     need not increase through the file; when they go backwards we
+    //     fall back to checking the chunks one at a time.  The offsets of
+    //     sender and type descriptions are kept so that a jump can play
+    //     those it skips over, leaving the name mappings as they would be
+    //     had every record been read.
+protected:
+    struct vrpn_FileIndexChunk {
+        vrpn_FileOffset offset; // of the first record in the chunk
+        timeval chunk_max;      // latest timestamp in the chunk
+        timeval running_max;    // latest timestamp up to the chunk's end
+    };
+#ifdef _MSC_VER
+#pragma warning(push)
+// Disable "need dll interface" warning on these members
+#pragma warning(disable : 4251)
+#endif
+    std::vector<vrpn_FileIndexChunk> d_index;
+    std::vector<vrpn_FileOffset> d_indexNames; // sender/type descriptions
+    // When accumulating, the list entries of the first record of each
+    // chunk that has been read, and which chunk each of those starts.
+    std::vector<vrpn_LOGLIST *> d_indexEntries;
+    std::map<const vrpn_LOGLIST *, size_t> d_indexEntryChunks;
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+    vrpn_FileOffset d_indexEnd;   // end of the last indexed record
+    bool d_indexWanted;           // Should THIS File Connection index?
+    int d_indexState;             // 0 not built yet, 1 built, -1 failed
+    timeval d_indexLowUserTime;   // earliest user message in the file
+    timeval d_indexHighUserTime;  // latest user message in the file
+    bool d_indexUserTimesValid;   // whether there are any user messages
+
+    // Builds the index if it has not been tried yet: from the in-memory
+    // list when preloading, otherwise from the sidecar or by scanning the
+    // file.  Returns true if the index is available.
+    bool build_index(void);
+    bool scan_index(FILE *log, vrpn_FileOffset log_size);
+    bool load_index(vrpn_FileOffset log_size);
+    bool save_index(vrpn_FileOffset log_size);
+    void index_record(vrpn_FileOffset offset, vrpn_int32 type,
+                      const timeval &t, size_t &records);
+    void note_index_entry(vrpn_LOGLIST *entry, vrpn_FileOffset offset);
+
+    // Index of the chunk holding the record at offset.
+    size_t find_index_chunk(vrpn_FileOffset offset) const;
+
+    // The first chunk after this one that holds something later than
+    // d_time, or the number of chunks if none does.
+    size_t find_later_index_chunk(size_t chunk) const;
+
+    // Moves forward to the first record later than d_time, skipping the
+    // chunks that end before it.  Same return as jump_to_time().
+    int jump_using_index(void);
+    int jump_using_accumulated_index(void);
+
     // }}}
     // {{{ handlers for VRPN control messages that might come from
     //     a File Controller object that wants to control this
@@ -320,7 +436,32 @@ protected:
     vrpn_LOGLIST *d_startEntry; // potentially after initial system messages
     bool d_preload;             // Should THIS File Connection pre-load?
     bool d_accumulate;          // Should THIS File Connection accumulate?
-                                // }}}
+
+    // When the file is mapped, read_entry() parses records out of the
+    // mapping at d_nextOffset, and the list entries are handed out of
+    // blocks rather than allocated one at a time.  Neither the entries nor
+    // their buffers are deleted individually.  Payloads that aren't
+    // aligned in the mapping are copied into d_mapScratch to be handled.
+    bool d_mapped;
+    const char *d_mapBase;
+    size_t d_mapSize;
+#ifdef _MSC_VER
+#pragma warning(push)
+// Disable "need dll interface" warning on these members
+#pragma warning(disable : 4251)
+#endif
+    std::vector<vrpn_LOGLIST *> d_mapBlocks;
+    std::vector<vrpn_float64> d_mapScratch;
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+    size_t d_mapBlockUsed; // entries handed out of the last block
+
+    bool map_file(void);
+    void unmap_file(void);
+    int read_mapped_entry(void);
+    const char *aligned_payload(const vrpn_HANDLERPARAM &header);
+    // }}}
 };
 
 #endif // VRPN_FILE_CONNECTION_H
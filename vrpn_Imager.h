@@ -22,6 +22,7 @@
 #define VRPN_IMAGER_H
 #include <stdio.h>  // for fprintf, stderr
 #include <string.h> // for NULL, memcpy
+#include <vector>   // for vector
 
 #include "vrpn_BaseClass.h" // for vrpn_Callback_List, etc
 #include "vrpn_Configure.h" // for VRPN_CALLBACK, VRPN_API
@@ -45,6 +46,14 @@ const unsigned vrpn_IMAGER_MAX_REGIONu16 =
     - 6 * sizeof(vrpn_int32)) /     // VRPN message header
     sizeof(vrpn_uint16);
 const unsigned vrpn_IMAGER_MAX_REGIONu12in16 = vrpn_IMAGER_MAX_REGIONu16;
+
+/// Number of bytes of a frame sent by vrpn_Imager_Server::send_frame() that
+/// go into each message.
+const unsigned vrpn_IMAGER_FRAME_CHUNK =
+    (vrpn_CONNECTION_TCP_BUFLEN
+    - 6 * sizeof(vrpn_int16)        // vrpn_Imager frame chunk header size
+    - 6 * sizeof(vrpn_int32))       // VRPN message header
+    & ~7u;                          // Keep chunks a whole number of values
 const unsigned vrpn_IMAGER_MAX_REGIONf32 =
     (vrpn_CONNECTION_TCP_BUFLEN
     - 8 * sizeof(vrpn_int16)        // vrpn_Imager header size
@@ -76,6 +85,14 @@ public:
     vrpn_float32 offset,
         scale; //< Values in units are (raw_values * scale) + offset
 
+    /// How region values for a channel are encoded when they are sent.
+    /// DELTA_BITPACK replaces each 8- or 16-bit value by its difference from
+    /// the value to its left (or above it, at the start of a row) and packs
+    /// each block of 32 differences into only as many bits as the largest
+    /// needs.  It is lossless, and typically halves noisy 12-bit camera
+    /// images.  Float regions are always sent as they are.
+    typedef enum { NONE = 0, DELTA_BITPACK = 1 } ChannelCompression;
+
 protected:
     // The following methods are here for the derived classes and are not
     // relevant
@@ -112,7 +129,6 @@ protected:
         }
     }
 
-    typedef enum { NONE = 0 } ChannelCompression;
     ChannelCompression d_compression;
 };
 
@@ -154,6 +170,8 @@ protected:
     // with 16-bit unsigned entries
     vrpn_int32 d_regionf32_m_id; //< ID of the message type describing a region
                                  // with 32-bit float entries
+    vrpn_int32 d_frame_chunk_m_id; //< ID of the message type carrying part
+                                   // of a whole frame sent by send_frame()
 };
 
 class VRPN_API vrpn_Imager_Server : public vrpn_Imager {
@@ -247,6 +265,32 @@ public:
         vrpn_uint16 dMin = 0, vrpn_uint16 dMax = 0,
         const struct timeval *time = NULL);
 
+    /// Send all of one channel of a frame as a single logical message, for
+    /// images too large to go into one region.  The values are split into
+    /// vrpn_IMAGER_FRAME_CHUNK-byte messages, which vrpn_Imager_Remote puts
+    /// back together before calling its frame handlers once with the whole
+    /// channel.  This sends the begin-frame and end-frame messages itself, so
+    /// throttling works the same as for frames sent as regions.  Columns must
+    /// be adjacent in data; rowStride and depthStride are in elements, and
+    /// zero means the rows or depth slices are packed together.  Frames are
+    /// not compressed.
+    bool send_frame(vrpn_int16 chanIndex, const vrpn_uint8 *data,
+                    vrpn_uint32 rowStride = 0, vrpn_uint32 depthStride = 0,
+                    const struct timeval *time = NULL);
+    bool send_frame(vrpn_int16 chanIndex, const vrpn_uint16 *data,
+                    vrpn_uint32 rowStride = 0, vrpn_uint32 depthStride = 0,
+                    const struct timeval *time = NULL);
+    bool send_frame(vrpn_int16 chanIndex, const vrpn_float32 *data,
+                    vrpn_uint32 rowStride = 0, vrpn_uint32 depthStride = 0,
+                    const struct timeval *time = NULL);
+
+    /// Choose how regions on a channel are compressed.  Clients find out
+    /// from the description and decode the regions before their handlers
+    /// see them, so this needs clients that know the compression.  Returns
+    /// false if the channel index or compression is not valid.
+    bool set_channel_compression(
+        int chanIndex, vrpn_Imager_Channel::ChannelCompression compression);
+
     /// Set the resolution to a different value than it had been before.
     /// Returns true on success.
     bool set_resolution(vrpn_int32 nCols, vrpn_int32 nRows,
@@ -277,6 +321,29 @@ protected:
     handle_throttle_message(void *userdata, vrpn_HANDLERPARAM p);
     static int VRPN_CALLBACK
     handle_last_drop_message(void *userdata, vrpn_HANDLERPARAM p);
+
+    /// Does the work for the send_frame() methods.  The strides are in bytes.
+    bool send_frame_values(vrpn_int16 chanIndex, vrpn_uint16 valType,
+                           unsigned valSize, const char *data,
+                           vrpn_uint32 rowStride, vrpn_uint32 depthStride,
+                           const struct timeval *time);
+
+    /// Compresses the values just packed between vals and end for a region
+    /// on a compressed channel, and fills in the codec word ahead of them
+    /// to say how they were sent (uncompressed, if compressing wouldn't
+    /// have made them smaller).  Returns the new end of the values.
+    char *compress_region(char *codec, char *vals, char *end, vrpn_uint32 cols,
+                          unsigned valSize);
+
+#ifdef _MSC_VER
+#pragma warning(push)
+// Disable "need dll interface" warning on these members
+#pragma warning(disable : 4251)
+#endif
+    std::vector<vrpn_uint8> d_encoded; //< Scratch space for compress_region()
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
 };
 
 class VRPN_API vrpn_ImagerPose : public vrpn_BaseClass {
@@ -427,6 +494,16 @@ typedef struct _vrpn_IMAGERDISCARDEDFRAMESCB {
     vrpn_uint16 count; //< Number of discarded frames (0 means "1 or more")
 } vrpn_IMAGERDISCARDEDFRAMESCB;
 
+typedef struct _vrpn_IMAGERFRAMECB {
+    struct timeval msg_time; //< Timestamp the server sent the frame with
+    vrpn_int16 chanIndex;    //< Which channel the frame holds data for
+    vrpn_uint16 valType;     //< Type of the values (vrpn_IMAGER_VALTYPE_*)
+    const void *data; //< nCols x nRows x nDepth values, column varying fastest
+    vrpn_uint32 length; //< Number of bytes of values
+} vrpn_IMAGERFRAMECB;
+
+typedef void(VRPN_CALLBACK *vrpn_IMAGERFRAMEHANDLER)(
+    void *userdata, const vrpn_IMAGERFRAMECB info);
 typedef void(VRPN_CALLBACK *vrpn_IMAGERBEGINFRAMEHANDLER)(
     void *userdata, const vrpn_IMAGERBEGINFRAMECB info);
 typedef void(VRPN_CALLBACK *vrpn_IMAGERENDFRAMEHANDLER)(
@@ -681,6 +758,27 @@ public:
         return d_end_frame_list.unregister_handler(userdata, handler);
     }
 
+    /// Register a handler for whole frames sent by the server's send_frame().
+    /// It is called once each channel of a frame has all arrived.  The data
+    /// is only valid during the callback.
+    virtual int register_frame_handler(void *userdata,
+                                       vrpn_IMAGERFRAMEHANDLER handler)
+    {
+        return d_frame_list.register_handler(userdata, handler);
+    };
+    virtual int unregister_frame_handler(void *userdata,
+                                         vrpn_IMAGERFRAMEHANDLER handler)
+    {
+        return d_frame_list.unregister_handler(userdata, handler);
+    }
+
+    /// Put whole frames arriving on a channel into the caller's buffer rather
+    /// than one of ours, so they need not be copied out of the callback.  The
+    /// buffer must stay valid until it is replaced; passing NULL goes back to
+    /// using our own.  Frames larger than size still go into ours.
+    bool set_frame_buffer(vrpn_int16 chanIndex, void *buffer,
+                          vrpn_uint32 size);
+
     /// Register a handler for discarded frame notifications (if the application
     /// cares)
     virtual int
@@ -737,6 +835,29 @@ protected:
     vrpn_Callback_List<vrpn_IMAGERBEGINFRAMECB> d_begin_frame_list;
     vrpn_Callback_List<vrpn_IMAGERENDFRAMECB> d_end_frame_list;
     vrpn_Callback_List<vrpn_IMAGERDISCARDEDFRAMESCB> d_discarded_frames_list;
+    vrpn_Callback_List<vrpn_IMAGERFRAMECB> d_frame_list;
+
+    /// A whole frame being put back together from its chunks.
+    struct Frame_Assembly {
+        vrpn_uint32 received; //< Bytes that have arrived, 0 between frames
+        char *buffer;         //< Where this frame is going
+        char *user_buffer;    //< Set by set_frame_buffer(), or NULL
+        vrpn_uint32 user_size;
+#ifdef _MSC_VER
+#pragma warning(push)
+// Disable "need dll interface" warning on these members
+#pragma warning(disable : 4251)
+#endif
+        std::vector<vrpn_float64> pool; //< Ours, kept from frame to frame
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+    };
+    Frame_Assembly d_frames[vrpn_IMAGER_MAX_CHANNELS];
+
+    /// Handler for part of a frame sent by send_frame().
+    static int VRPN_CALLBACK
+    handle_frame_chunk_message(void *userdata, vrpn_HANDLERPARAM p);
 
     /// Handler for region update message from the server.
     static int VRPN_CALLBACK
@@ -761,6 +882,21 @@ protected:
     /// Handler for discarded-frames message from the server.
     static int VRPN_CALLBACK
     handle_discarded_frames_message(void *userdata, vrpn_HANDLERPARAM p);
+
+    /// Points the region at its values, decoding them first if they were
+    /// compressed.  buf and len are what follows the region's header.
+    bool decode_region(const char *buf, vrpn_int32 len,
+                       vrpn_Imager_Region &reg);
+
+#ifdef _MSC_VER
+#pragma warning(push)
+// Disable "need dll interface" warning on these members
+#pragma warning(disable : 4251)
+#endif
+    std::vector<vrpn_uint16> d_decoded; //< Decompressed values, little-endian
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
 };
 
 //------------------------------------------------------------------------------
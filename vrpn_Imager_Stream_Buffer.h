@@ -130,6 +130,7 @@ public:
         d_new_throttle_request = false;
         d_throttle_count = -1;
         d_frames_in_queue = 0;
+        d_logger_to_client_messages.clear();
     }
 
     // Accessors for the "time to exit" flag; set by the initial thread and
@@ -447,24 +448,30 @@ public:
     }
 
     // Accessors for the logging thread to add messages to the queue
-    // and for the initial thread to retrieve and count them.
+    // and for the initial thread to look at, remove and count them.  These
+    // do not use the semaphore; the queue handles its own synchronization.
+    // The logging thread blocks in insert if the queue is full.  The buffer
+    // of a message returned by peek is owned by the queue and is valid until
+    // the message is popped.
     vrpn_int32 get_logger_to_client_queue_size(void)
     {
-        vrpn::SemaphoreGuard guard(d_sem);
-        vrpn_int32 ret = d_logger_to_client_messages.size();
-        return ret;
+        return d_logger_to_client_messages.size();
     }
     bool insert_logger_to_client_message(const vrpn_HANDLERPARAM &p)
     {
-        vrpn::SemaphoreGuard guard(d_sem);
-        bool ret = d_logger_to_client_messages.insert_back(p);
-        return ret;
+        return d_logger_to_client_messages.insert_back(p);
     }
-    bool retrieve_logger_to_client_message(vrpn_HANDLERPARAM *p)
+    bool peek_logger_to_client_message(vrpn_HANDLERPARAM *p)
     {
-        vrpn::SemaphoreGuard guard(d_sem);
-        bool ret = d_logger_to_client_messages.retrieve_front(p);
-        return ret;
+        return d_logger_to_client_messages.peek_front(p);
+    }
+    void pop_logger_to_client_message(void)
+    {
+        d_logger_to_client_messages.pop_front();
+    }
+    void clear_logger_to_client_messages(void)
+    {
+        d_logger_to_client_messages.clear();
     }
 
 protected:
@@ -514,9 +521,9 @@ protected:
     // as the begin_frame() messages are queued and dequeued.
     vrpn_int32 d_frames_in_queue;
 
-    // List of messages passing from the logging thread to the initial
+    // Queue of messages passing from the logging thread to the initial
     // thread.
-    vrpn_Message_List d_logger_to_client_messages;
+    vrpn_Message_Ring d_logger_to_client_messages;
 };
 
 //-------------------------------------------------------------------
@@ -688,6 +695,8 @@ protected:
     // region with 16-bit unsigned entries
     vrpn_int32 d_server_regionf32_m_id; //< ID of the message type describing a
     // region with 32-bit float entries
+    vrpn_int32 d_server_frame_chunk_m_id; //< ID of the message type carrying
+    // part of a whole frame
     vrpn_int32 d_server_text_m_id; //< ID of the system text message
     vrpn_int32 d_server_ping_m_id; //< ID of the system ping message
     vrpn_int32 d_server_pong_m_id; //< ID of the system pong message
@@ -27,7 +27,21 @@ public:
     ///< Closes and saves the log file.
 
     int saveLogSoFar(void);
-    ///< Saves any messages logged so far.
+    ///< Saves any messages logged so far.  When streaming, this only hands
+    ///< what has been logged to the writer thread, and only if there is a
+    ///< free buffer to carry on logging into, so it never waits on the disk.
+
+    int setStreaming(vrpn_uint32 bufferSize = vrpn_LOG_STREAM_BUFFER_SIZE,
+                     vrpn_uint32 numBuffers = vrpn_LOG_STREAM_NUM_BUFFERS);
+    ///< Rather than keeping every message in memory until saveLogSoFar() or
+    ///< close(), copy them into a fixed set of buffers that a background
+    ///< thread writes to the file as each one fills.  If the disk falls so
+    ///< far behind that all of the buffers are full, new messages are
+    ///< dropped and counted rather than held.  The file is the same either
+    ///< way.  Can be called before or after open().  Returns -1 if threads
+    ///< aren't available or the log is already streaming.
+
+    void getStreamStats(vrpn_LogStreamStats* stats);
 
     int logIncomingMessage(size_t payloadLen, struct timeval time,
                            vrpn_int32 type, vrpn_int32 sender,
@@ -89,6 +103,38 @@ protected:
     vrpn_TranslationTable* d_types;
 
     timeval d_lastLogTime;
+
+    /// @name Used when streaming the log to disk; see setStreaming().
+    /// The buffers are filled and written in turn around the ring.
+    /// @{
+    struct StreamBuffer {
+        char* data;
+        vrpn_uint32 used;    ///< Bytes in data
+        vrpn_uint32 records; ///< Messages in data
+    };
+    StreamBuffer* d_streamBuffers;
+    vrpn_uint32 d_streamBufferSize;
+    vrpn_uint32 d_streamNumBuffers; ///< 0 if we're not streaming
+    vrpn_uint32 d_streamFill;       ///< Buffer logMessage() is filling
+    bool d_streamHaveBuffer;        ///< False if none was free last we looked
+
+    // Shared with the writer thread, protected by d_streamLock.
+    vrpn_uint32 d_streamNext; ///< Next buffer for the writer to write
+    vrpn_uint32 d_streamFull; ///< Buffers handed to the writer
+    bool d_streamStop;        ///< Tells the writer to finish and exit
+    vrpn_LogStreamStats d_streamStats;
+    vrpn_Semaphore d_streamLock;
+
+    vrpn_Thread* d_streamThread; ///< NULL unless the writer is running
+
+    int startStreaming(void);
+    int stopStreaming(void);
+    int streamMessage(const char* header, vrpn_int32 headerLen,
+                      const char* payload, vrpn_int32 payloadLen);
+    void handOffStreamBuffer(void);
+    bool getStreamBuffer(void);
+    static void streamWriterThread(vrpn_ThreadData& threadData);
+    /// @}
 };
 
 #endif // VRPN_LOG_H
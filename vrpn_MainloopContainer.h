@@ -25,23 +25,41 @@
 
 // Internal Includes
 #include "vrpn_MainloopObject.h"
+#include "vrpn_Shared.h" // for vrpn_gettimeofday, vrpn_SleepMsecs
+#include "vrpn_Thread.h" // for vrpn_Thread, vrpn_atomic_load, etc
 
 // Library/third-party includes
 // - none
 
 // Standard includes
+#include <stdio.h> // for fprintf, stderr
 #include <vector>
 
+#if defined(VRPN_HAVE_ATOMICS) && defined(VRPN_HAVE_THREAD_LOCAL)
+#define VRPN_MAINLOOPCONTAINER_THREADS
+#endif
+
+/// How long a thread group can go without getting through its objects'
+/// mainloop()s before vrpn_MainloopContainer::mainloop() reports it stuck.
+const int vrpn_MAINLOOP_WATCHDOG_SECONDS = 3;
+
 /// A container that holds and owns one or more VRPN objects,
+/// running their mainloop()s either in its own mainloop() or in threads
+/// of their own.
 class vrpn_MainloopContainer {
 public:
     /// Constructor
-    vrpn_MainloopContainer() {}
+    vrpn_MainloopContainer()
+        : _group(0)
+        , _connection(NULL)
+        , _started(false)
+    {
+    }
     /// Destructor: invokes clear()
     ~vrpn_MainloopContainer();
 
-    /// Clear internal structure holding objects, deleting them
-    /// in reverse order of their addition.
+    /// Stop any threads, then clear internal structure holding objects,
+    /// deleting them in reverse order of their addition.
     void clear();
 
     /// Add an object wrapped by vrpn_MainloopObject.
@@ -60,12 +78,65 @@ public:
         return o;
     }
 
-    /// Runs mainloop on all contained objects, in the order
-    /// that they were added.
+    /// @brief Objects added after this are run by a thread for the group
+    /// rather than by mainloop(); group 0 (the default) means mainloop().
+    ///
+    /// Each group has one thread, which calls the mainloop() of each of its
+    /// objects in turn, so a device that blocks (reopening a serial port,
+    /// waiting for a USB device to come back) only holds up the others in
+    /// its group.  The messages that they pack into the connection are
+    /// queued and then packed by mainloop(), which must be called from the
+    /// thread that runs the connection.  Message handlers registered by the
+    /// objects are still called from that thread, so an object should only
+    /// be put into a group if its handlers are safe to call while its
+    /// mainloop() runs.  The first mainloop() of each object is also called
+    /// from mainloop(), because servers register their handlers there.
+    /// If the platform can't do this, objects run in mainloop() as usual.
+    void set_thread_group(int group, vrpn_Connection *c);
+
+    /// Runs mainloop on all contained objects that are not in a thread
+    /// group, in the order that they were added, and packs the messages
+    /// that the thread groups have sent since last time.  Starts the
+    /// thread groups the first time it is called.
     void mainloop();
 
 private:
-    std::vector<vrpn_MainloopObject *> _vrpn;
+    struct Worker {
+        Worker(int g, vrpn_Connection *c)
+            : group(g)
+            , connection(c)
+            , messages(256)
+            , thread(NULL)
+            , exit(0)
+            , passes(0)
+            , last_passes(0)
+            , stalled(false)
+        {
+            last_progress.tv_sec = last_progress.tv_usec = 0;
+        }
+        int group;
+        vrpn_Connection *connection;
+        std::vector<vrpn_MainloopObject *> objects;
+        vrpn_Message_Ring messages; ///< From the thread to the connection
+        vrpn_Thread *thread;
+        volatile vrpn_uint32 exit;   ///< Set to tell the thread to stop
+        volatile vrpn_uint32 passes; ///< Times through all of the objects
+        vrpn_uint32 last_passes;     ///< What the watchdog saw last
+        struct timeval last_progress;
+        bool stalled;
+    };
+
+    void start_threads();
+    void stop_threads();
+    void watchdog(Worker *w);
+    static void worker_thread(vrpn_ThreadData &td);
+
+    std::vector<vrpn_MainloopObject *> _vrpn; ///< All of them, for clear()
+    std::vector<vrpn_MainloopObject *> _main; ///< Those run by mainloop()
+    std::vector<Worker *> _workers;
+    int _group;
+    vrpn_Connection *_connection;
+    bool _started;
 };
 
 /* -- inline implementations -- */
@@ -90,11 +161,55 @@ inline vrpn_MainloopObject *vrpn_MainloopContainer::add(vrpn_MainloopObject *o)
     }
 
     _vrpn.push_back(o);
+    if (_group == 0) {
+        _main.push_back(o);
+        return o;
+    }
+
+    // Find the thread group, making it if this is its first object.
+    Worker *w = NULL;
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        if (_workers[i]->group == _group) {
+            w = _workers[i];
+        }
+    }
+    if (!w) {
+        w = new Worker(_group, _connection);
+        _workers.push_back(w);
+    }
+    w->objects.push_back(o);
     return o;
 }
 
+inline void vrpn_MainloopContainer::set_thread_group(int group,
+                                                     vrpn_Connection *c)
+{
+#ifdef VRPN_MAINLOOPCONTAINER_THREADS
+    if (group == 0) {
+        _group = 0;
+        return;
+    }
+    if (!vrpn_Thread::available() || (c == NULL)) {
+        fprintf(stderr, "vrpn_MainloopContainer::set_thread_group(): "
+                        "Threads not available, running in mainloop()\n");
+        _group = 0;
+        return;
+    }
+    _group = group;
+    _connection = c;
+#else
+    if (group != 0) {
+        fprintf(stderr, "vrpn_MainloopContainer::set_thread_group(): "
+                        "Threads not available, running in mainloop()\n");
+    }
+    (void)c;
+#endif
+}
+
 inline void vrpn_MainloopContainer::clear()
 {
+    stop_threads();
+    _main.clear();
     if (_vrpn.empty()) {
         return;
     }
@@ -108,8 +223,133 @@ inline void vrpn_MainloopContainer::clear()
 
 inline void vrpn_MainloopContainer::mainloop()
 {
-    const size_t n = _vrpn.size();
+    if (!_started) {
+        start_threads();
+    }
+    const size_t n = _main.size();
     for (size_t i = 0; i < n; ++i) {
-        _vrpn[i]->mainloop();
+        _main[i]->mainloop();
+    }
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        _workers[i]->connection->pack_deferred_messages(
+            &_workers[i]->messages);
+        watchdog(_workers[i]);
+    }
+}
+
+inline void vrpn_MainloopContainer::start_threads()
+{
+    _started = true;
+#ifdef VRPN_MAINLOOPCONTAINER_THREADS
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        Worker *w = _workers[i];
+        for (size_t j = 0; j < w->objects.size(); ++j) {
+            w->objects[j]->mainloop();
+        }
+        vrpn_gettimeofday(&w->last_progress, NULL);
+
+        vrpn_ThreadData td;
+        td.pvUD = w;
+        w->thread = new vrpn_Thread(worker_thread, td);
+        if (!w->thread->go()) {
+            fprintf(stderr, "vrpn_MainloopContainer::start_threads(): Can't "
+                            "start thread for group %d, running in "
+                            "mainloop()\n",
+                    w->group);
+            delete w->thread;
+            w->thread = NULL;
+            _main.insert(_main.end(), w->objects.begin(), w->objects.end());
+            w->objects.clear();
+        }
+    }
+#endif
+}
+
+// Asks the threads to stop, and gives each up to three seconds to do so
+// before killing it.  Their messages are packed while waiting, so that none
+// of them is stuck waiting for room in its queue.
+inline void vrpn_MainloopContainer::stop_threads()
+{
+#ifdef VRPN_MAINLOOPCONTAINER_THREADS
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        vrpn_atomic_store(&_workers[i]->exit, 1);
+    }
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        Worker *w = _workers[i];
+        if (w->thread) {
+            struct timeval start, now;
+            vrpn_gettimeofday(&start, NULL);
+            do {
+                w->connection->pack_deferred_messages(&w->messages);
+                if (!w->thread->running()) {
+                    break;
+                }
+                vrpn_SleepMsecs(1);
+                vrpn_gettimeofday(&now, NULL);
+            } while (vrpn_TimevalDurationSeconds(now, start) < 3);
+            if (w->thread->running()) {
+                fprintf(stderr, "vrpn_MainloopContainer::stop_threads(): "
+                                "Killing thread for group %d\n",
+                        w->group);
+                w->thread->kill();
+            }
+            delete w->thread;
+        }
+        delete w;
+    }
+#endif
+    _workers.clear();
+    _started = false;
+}
+
+// Reports a thread group that hasn't made it through its objects for a
+// while, and reports it again when it does.
+inline void vrpn_MainloopContainer::watchdog(Worker *w)
+{
+#ifdef VRPN_MAINLOOPCONTAINER_THREADS
+    if (!w->thread) {
+        return;
+    }
+    struct timeval now;
+    vrpn_gettimeofday(&now, NULL);
+    vrpn_uint32 passes = vrpn_atomic_load(&w->passes);
+    if (passes != w->last_passes) {
+        if (w->stalled) {
+            fprintf(stderr, "vrpn_MainloopContainer: Thread group %d is "
+                            "running again\n",
+                    w->group);
+            w->stalled = false;
+        }
+        w->last_passes = passes;
+        w->last_progress = now;
+    }
+    else if (!w->stalled &&
+             (vrpn_TimevalDurationSeconds(now, w->last_progress) >=
+              vrpn_MAINLOOP_WATCHDOG_SECONDS)) {
+        fprintf(stderr, "vrpn_MainloopContainer: Thread group %d has been "
+                        "stuck in mainloop() for %d seconds\n",
+                w->group, vrpn_MAINLOOP_WATCHDOG_SECONDS);
+        w->stalled = true;
+    }
+#else
+    (void)w;
+#endif
+}
+
+inline void vrpn_MainloopContainer::worker_thread(vrpn_ThreadData &td)
+{
+#ifdef VRPN_MAINLOOPCONTAINER_THREADS
+    Worker *w = static_cast<Worker *>(td.pvUD);
+    w->connection->defer_messages_from_this_thread(&w->messages);
+    while (!vrpn_atomic_load(&w->exit)) {
+        for (size_t i = 0; i < w->objects.size(); ++i) {
+            w->objects[i]->mainloop();
+        }
+        vrpn_atomic_store(&w->passes, w->passes + 1);
+        vrpn_SleepMsecs(1);
     }
+    w->connection->defer_messages_from_this_thread(NULL);
+#else
+    (void)td;
+#endif
 }
@@ -0,0 +1,199 @@
+#ifndef VRPN_SHM_CONNECTION_H
+#define VRPN_SHM_CONNECTION_H
+
+// vrpn_Connection_SHM
+//
+// A connection between a server and clients running on the same machine,
+// through a POSIX shared-memory segment rather than TCP and UDP.
+//
+// The server writes each message once into a ring in the segment, and
+// every client reads it from there: no sockets, no system calls and no
+// per-client copies on the way out.  Each client has a smaller ring of its
+// own in the segment for messages going back to the server.  A process
+// waiting in mainloop() for something to arrive sleeps on a futex in the
+// segment, which the other side wakes when it sends.
+//
+// Servers are made by calling vrpn_create_server_connection() with a name
+// like "shm:tracker_box" and clients by asking vrpn_get_connection_by_name()
+// for "Tracker0@shm:tracker_box".  Message semantics are the same as over
+// IP, except that there is no UDP: everything is delivered in order, and a
+// client that falls so far behind that the server would have to overwrite
+// messages it hasn't read yet is dropped (it reconnects straight away) rather
+// than having only its LOW_LATENCY messages go missing.  Remote logging is
+// not supported.
+
+#include "vrpn_Configure.h"  // for VRPN_API, VRPN_USE_SHM
+#include "vrpn_Connection.h" // for vrpn_Connection, vrpn_Endpoint
+#include "vrpn_Shared.h"     // for timeval
+#include "vrpn_Types.h"      // for vrpn_int32, vrpn_uint32
+
+#ifdef VRPN_USE_SHM
+
+#include <vector> // for vector
+
+/// Size of the ring the server writes into, unless another is asked for.
+const vrpn_uint32 vrpn_SHM_DEFAULT_RING_SIZE = 1024 * 1024;
+/// Size of the ring each client writes into.
+const vrpn_uint32 vrpn_SHM_CLIENT_RING_SIZE = 128 * 1024;
+/// How many clients can be attached to one server at a time.
+const int vrpn_SHM_MAX_CLIENTS = 16;
+/// Permissions of the segment a server creates.  Anyone who can open it
+/// can write into the rings, so only the server's user can by default;
+/// define this (for example as 0660) to share the server with a group.
+#ifndef VRPN_SHM_SEGMENT_MODE
+#define VRPN_SHM_SEGMENT_MODE 0600
+#endif
+
+struct vrpn_SHMSegment;
+struct vrpn_SHMRing;
+
+/// @brief Sends and receives a connection's messages through rings in a
+/// shared-memory segment.
+///
+/// A client has one, which reads the server's ring and writes its own.  A
+/// server has one for each client, which reads that client's ring, and
+/// one more that writes all of its messages into its ring.
+/// This will only be used from within the vrpn_Connection_SHM class.
+
+class VRPN_API vrpn_Endpoint_SHM : public vrpn_Endpoint {
+
+public:
+    vrpn_Endpoint_SHM(vrpn_TypeDispatcher *dispatcher,
+                      vrpn_int32 *connectedEndpointCounter);
+    virtual ~vrpn_Endpoint_SHM(void);
+
+    virtual vrpn_bool doing_okay(void) const;
+
+    /// Handles the messages waiting in the ring we read.  The timeout is
+    /// ignored; vrpn_Connection_SHM does all of the waiting.  Returns the
+    /// number handled, or -1 on error.
+    virtual int mainloop(timeval *timeout);
+
+    virtual int pack_message(vrpn_uint32 len, struct timeval time,
+                             vrpn_int32 type, vrpn_int32 sender,
+                             const char *buffer, vrpn_uint32 class_of_service);
+    virtual int send_pending_reports(void);
+
+    virtual int setup_new_connection(void);
+    virtual void poll_for_cookie(const timeval *timeout = NULL);
+    virtual int finish_new_connection_setup(void);
+    virtual void drop_connection(void);
+    virtual void clearBuffers(void);
+
+    void set_rings(vrpn_SHMRing *in, vrpn_SHMRing *out);
+    ///< Either may be NULL.  The endpoint does not own them.
+
+protected:
+    vrpn_SHMRing *d_in;
+    vrpn_SHMRing *d_out;
+    vrpn_uint32 d_sequenceNumber;
+
+#ifdef _MSC_VER
+#pragma warning(push)
+// Disable "need dll interface" warning on these members
+#pragma warning(disable : 4251)
+#endif
+    std::vector<vrpn_float64> d_inbuf;
+    ///< Messages are copied here out of a ring that might be overwritten.
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+};
+
+/// @brief Connection between a server and clients on the same machine
+/// through shared memory.
+
+class VRPN_API vrpn_Connection_SHM : public vrpn_Connection {
+
+protected:
+    /// Make a server connection, which creates the segment.  To access this
+    /// from user code, call vrpn_create_server_connection() with a service
+    /// name of 'shm:segment_name'.  The ring size is rounded up to a power
+    /// of two.
+    vrpn_Connection_SHM(const char *station_name, vrpn_uint32 ring_size,
+                        const char *local_in_logfile_name,
+                        const char *local_out_logfile_name);
+
+    /// Make a client connection, which attaches to a server's segment
+    /// (and keeps trying to, if it isn't there yet).  To access this from
+    /// user code, call vrpn_get_connection_by_name() with a service name
+    /// of 'device@shm:segment_name'.
+    vrpn_Connection_SHM(const char *station_name,
+                        const char *local_in_logfile_name,
+                        const char *local_out_logfile_name);
+
+public:
+    virtual ~vrpn_Connection_SHM(void);
+
+    virtual vrpn_bool doing_okay(void) const;
+    virtual vrpn_bool connected(void) const;
+
+    /// Handles incoming messages and clients attaching and leaving.  If
+    /// nothing is waiting, sleeps for up to the timeout for something to
+    /// arrive (NULL means don't wait).
+    virtual int mainloop(const struct timeval *timeout = NULL);
+
+    virtual vrpn_int32 register_sender(const char *name);
+    virtual vrpn_int32 register_message_type(const char *name);
+
+    /// Wakes anyone waiting for the messages that have been packed.
+    virtual int send_pending_reports(void);
+
+protected:
+    friend VRPN_API vrpn_Connection *
+    vrpn_create_server_connection(const char *cname,
+                                  const char *local_in_logfile_name,
+                                  const char *local_out_logfile_name);
+    friend VRPN_API vrpn_Connection *vrpn_get_connection_by_name(
+        const char *cname, const char *local_in_logfile_name,
+        const char *local_out_logfile_name, const char *remote_in_logfile_name,
+        const char *remote_out_logfile_name, const char *NIC_IPaddress,
+        bool force_connection);
+
+    virtual int pack_group_message(vrpn_uint32 len, struct timeval time,
+                                   vrpn_int32 type, vrpn_int32 sender,
+                                   const char *buffer,
+                                   vrpn_uint32 class_of_service);
+    ///< Writes the message into our ring, once for all of the clients.
+    virtual int pack_sender_description(vrpn_int32 which);
+    virtual int pack_type_description(vrpn_int32 which);
+
+    int server_mainloop(const struct timeval *timeout);
+    int client_mainloop(const struct timeval *timeout);
+
+    /// @name Server
+    /// @{
+    int create_segment(vrpn_uint32 ring_size);
+    void accept_client(int which);
+    void drop_client(int which);
+    void check_clients(void);
+    ///< Accepts clients that are attaching and drops those that have left.
+    vrpn_Endpoint_SHM *d_clients[vrpn_SHM_MAX_CLIENTS];
+    vrpn_Endpoint_SHM *d_broadcast; ///< Writes into our ring
+    /// @}
+
+    /// @name Client
+    /// @{
+    int attach(void);
+    ///< Returns 0 if we got a slot in the server's segment, -1 if not.
+    void detach(void);
+    vrpn_Endpoint_SHM *d_endpoint;
+    int d_slot;
+    timeval d_last_attach_attempt;
+    /// @}
+
+    void set_segment_name(const char *station_name);
+    bool work_waiting(void) const;
+    ///< True if the other side has sent something or changed state.
+    void wait_for_work(const struct timeval *timeout);
+    ///< Sleeps until the other side wakes us or the timeout expires.
+
+    bool d_server;
+    char *d_segment_name; ///< Including the leading '/'
+    vrpn_SHMSegment *d_segment;
+    timeval d_last_liveness_check;
+};
+
+#endif // VRPN_USE_SHM
+
+#endif // VRPN_SHM_CONNECTION_H
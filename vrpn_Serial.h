@@ -75,6 +75,33 @@ extern VRPN_API int vrpn_read_available_characters(int comm,
                                                    struct timeval *timeout);
 /// @}
 
+/// @name Background readers
+///
+/// A port can be given a thread of its own that waits in poll() for
+/// characters to arrive and keeps them, along with the time each batch
+/// arrived, until vrpn_read_available_characters() asks for them.  Devices
+/// that are only polled once per pass through the server loop can then
+/// stamp their reports with when the data actually came in rather than when
+/// they got around to looking.  vrpn_flush_input_buffer() throws out what
+/// the reader has kept and vrpn_close_commport() stops it.
+///
+/// vrpn_start_serial_reader() returns 0 on success, or -1 if there can't be
+/// a reader for the port on this platform; reads then go straight to the
+/// port as before.  vrpn_stop_serial_reader() returns 0 on success, or -1 if
+/// the port had no reader.  Only the thread that reads a port may start or
+/// stop its reader.
+/// @{
+extern VRPN_API int vrpn_start_serial_reader(int comm);
+extern VRPN_API int vrpn_stop_serial_reader(int comm);
+
+/// @brief Fill in when the last character returned by
+/// vrpn_read_available_characters() arrived.
+///
+/// Ports without a reader get the current time, which is what drivers
+/// used before there were readers.
+extern VRPN_API void vrpn_serial_arrival_time(int comm, struct timeval *when);
+/// @}
+
 /// @name Write routines
 ///
 /// Write the specified number of characters.  Some devices can't accept writes
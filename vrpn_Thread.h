@@ -25,6 +25,7 @@
 
 // Internal Includes
 #include "vrpn_Configure.h" // for VRPN_API
+#include "vrpn_Types.h"     // for vrpn_uint32
 
 // Library/third-party includes
 // - none
@@ -161,6 +162,63 @@ namespace vrpn {
 
 } // namespace vrpn
 
+/// @name Atomic access to a word shared between two threads
+/// vrpn_atomic_load() acquires and vrpn_atomic_store() releases: whatever a
+/// thread wrote before storing a value is visible to another thread once it
+/// loads that value.  vrpn_atomic_exchange() is a full barrier.
+/// VRPN_HAVE_ATOMICS is only defined on compilers that provide these; code
+/// that uses them needs to fall back to a vrpn_Semaphore elsewhere.
+/// @{
+#if defined(__clang__) ||                                                      \
+    (defined(__GNUC__) &&                                                      \
+     ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 7))))
+#define VRPN_HAVE_ATOMICS
+inline vrpn_uint32 vrpn_atomic_load(const volatile vrpn_uint32 *v)
+{
+    return __atomic_load_n(v, __ATOMIC_ACQUIRE);
+}
+inline void vrpn_atomic_store(volatile vrpn_uint32 *v, vrpn_uint32 val)
+{
+    __atomic_store_n(v, val, __ATOMIC_RELEASE);
+}
+inline vrpn_uint32 vrpn_atomic_exchange(volatile vrpn_uint32 *v,
+                                        vrpn_uint32 val)
+{
+    return __atomic_exchange_n(v, val, __ATOMIC_SEQ_CST);
+}
+#elif defined(_MSC_VER) && (_MSC_VER >= 1400)
+#include <intrin.h> // for _InterlockedExchange, _InterlockedOr
+#define VRPN_HAVE_ATOMICS
+inline vrpn_uint32 vrpn_atomic_load(const volatile vrpn_uint32 *v)
+{
+    return static_cast<vrpn_uint32>(_InterlockedOr(
+        reinterpret_cast<volatile long *>(const_cast<volatile vrpn_uint32 *>(v)),
+        0));
+}
+inline vrpn_uint32 vrpn_atomic_exchange(volatile vrpn_uint32 *v,
+                                        vrpn_uint32 val)
+{
+    return static_cast<vrpn_uint32>(_InterlockedExchange(
+        reinterpret_cast<volatile long *>(v), static_cast<long>(val)));
+}
+inline void vrpn_atomic_store(volatile vrpn_uint32 *v, vrpn_uint32 val)
+{
+    vrpn_atomic_exchange(v, val);
+}
+#endif
+/// @}
+
+/// VRPN_THREAD_LOCAL declares a variable that each thread has its own copy
+/// of.  It is only defined (as is VRPN_HAVE_THREAD_LOCAL) on compilers that
+/// support it; it can only be used on plain data.
+#if defined(__GNUC__) || defined(__clang__)
+#define VRPN_HAVE_THREAD_LOCAL
+#define VRPN_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define VRPN_HAVE_THREAD_LOCAL
+#define VRPN_THREAD_LOCAL __declspec(thread)
+#endif
+
 // A ptr to this struct will be passed to the
 // thread function.  The user data ptr will be in pvUD.
 // (There used to be a non-functional semaphore object